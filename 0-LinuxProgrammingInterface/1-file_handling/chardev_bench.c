@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/*
+ * Streaming load generator for a char device (my_device.c / ioctl_kmodule.c).
+ *
+ * Every reader/writer thread opens its own fd on one of the given device
+ * nodes (round robin, so several minors are driven at once), then loops on
+ * read()/write() of -s bytes until -t seconds are over. Each call is timed
+ * and put in a log2 latency histogram.
+ */
+
+#define HIST_BUCKETS 40         /* 2^0 .. 2^39 ns (~9 min), more than enough */
+#define MAX_DEVICES  64
+
+struct bench_thread {
+    pthread_t tid;
+    int id;
+    int is_writer;
+    const char *dev;
+    size_t msg_size;
+
+    unsigned long long ops;
+    unsigned long long bytes;
+    unsigned long long eof;     /* read() returned 0 */
+    unsigned long long again;   /* EAGAIN with -n */
+    unsigned long long max_ns;
+    unsigned long long hist[HIST_BUCKETS];
+    int err;
+};
+
+static atomic_int stop;
+static pthread_barrier_t start_line;
+static int nonblock;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [-r <readers>] [-w <writers>] [-s <msg size>] [-t <seconds>] [-n] [-v] [device ...]\n", prog_name);
+    printf("  -r <n>      reader threads (default 1)\n");
+    printf("  -w <n>      writer threads (default 1)\n");
+    printf("  -s <bytes>  bytes per read()/write() call (default 64)\n");
+    printf("  -t <sec>    run time in seconds (default 5)\n");
+    printf("  -n          open with O_NONBLOCK, EAGAIN is counted not failed\n");
+    printf("  -v          print the full latency histograms\n");
+    printf("  device ...  device nodes, threads are spread round robin (default /dev/my_device)\n");
+}
+
+static unsigned long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int hist_bucket(unsigned long long ns) {
+    int b = ns ? 63 - __builtin_clzll(ns) : 0;
+    return b < HIST_BUCKETS ? b : HIST_BUCKETS - 1;
+}
+
+static void *bench_thread_fn(void *arg) {
+    struct bench_thread *t = arg;
+    char *buf;
+    int fd;
+
+    buf = malloc(t->msg_size);
+    fd = open(t->dev, (t->is_writer ? O_WRONLY : O_RDONLY) | (nonblock ? O_NONBLOCK : 0));
+    if (!buf || fd < 0) {
+        t->err = buf ? errno : ENOMEM;
+        pthread_barrier_wait(&start_line);
+        free(buf);
+        return NULL;
+    }
+    memset(buf, 'a' + t->id % 26, t->msg_size);
+
+    pthread_barrier_wait(&start_line);
+
+    while (!atomic_load_explicit(&stop, memory_order_relaxed)) {
+        unsigned long long t0 = now_ns();
+        ssize_t ret = t->is_writer ? write(fd, buf, t->msg_size)
+                                   : read(fd, buf, t->msg_size);
+        unsigned long long dt = now_ns() - t0;
+
+        if (ret < 0) {
+            if (errno == EAGAIN || errno == EINTR) {
+                t->again++;
+                continue;
+            }
+            t->err = errno;
+            break;
+        }
+        /* an empty device is not an op: counted apart, out of ops/s and latency */
+        if (ret == 0) {
+            t->eof++;
+            continue;
+        }
+
+        t->ops++;
+        t->bytes += ret;
+        t->hist[hist_bucket(dt)]++;
+        if (dt > t->max_ns)
+            t->max_ns = dt;
+    }
+
+    close(fd);
+    free(buf);
+    return NULL;
+}
+
+/* upper bound of the bucket holding the q-th quantile */
+static unsigned long long hist_quantile(const unsigned long long *hist, unsigned long long total, double q) {
+    unsigned long long want = (unsigned long long)(total * q), seen = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen > want)
+            return 2ULL << b;
+    }
+    return 2ULL << (HIST_BUCKETS - 1);
+}
+
+static void report(const char *name, struct bench_thread *threads, int nthreads,
+                   int is_writer, double secs, int verbose) {
+    unsigned long long hist[HIST_BUCKETS] = {0};
+    unsigned long long ops = 0, bytes = 0, eof = 0, again = 0, max_ns = 0;
+    int n = 0;
+
+    for (int i = 0; i < nthreads; i++) {
+        struct bench_thread *t = &threads[i];
+
+        if (t->is_writer != is_writer)
+            continue;
+        n++;
+        ops += t->ops;
+        bytes += t->bytes;
+        eof += t->eof;
+        again += t->again;
+        if (t->max_ns > max_ns)
+            max_ns = t->max_ns;
+        for (int b = 0; b < HIST_BUCKETS; b++)
+            hist[b] += t->hist[b];
+    }
+    if (n == 0)
+        return;
+
+    printf("%s: %d threads, %llu ops, %.0f ops/s, %.2f MB/s",
+           name, n, ops, ops / secs, bytes / secs / (1024 * 1024));
+    if (eof)
+        printf(", %llu EOF", eof);
+    if (again)
+        printf(", %llu EAGAIN", again);
+    printf("\n");
+    if (ops == 0)
+        return;
+
+    printf("  latency ns: p50<%llu p90<%llu p99<%llu p99.9<%llu max=%llu\n",
+           hist_quantile(hist, ops, 0.50), hist_quantile(hist, ops, 0.90),
+           hist_quantile(hist, ops, 0.99), hist_quantile(hist, ops, 0.999), max_ns);
+
+    if (!verbose)
+        return;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (!hist[b])
+            continue;
+        int bar = (int)(hist[b] * 50 / ops);
+        printf("  [%12llu, %12llu) %12llu |%.*s\n", 1ULL << b, 2ULL << b, hist[b],
+               bar, "##################################################");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const char *devices[MAX_DEVICES] = { "/dev/my_device" };
+    int ndevices = 1;
+    int readers = 1, writers = 1;
+    size_t msg_size = 64;
+    int seconds = 5;
+    int verbose = 0;
+    int ret = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "r:w:s:t:nv")) != -1) {
+        switch (opt) {
+            case 'r':
+                readers = atoi(optarg);
+                break;
+            case 'w':
+                writers = atoi(optarg);
+                break;
+            case 's':
+                msg_size = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                seconds = atoi(optarg);
+                break;
+            case 'n':
+                nonblock = 1;
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind < argc) {
+        ndevices = 0;
+        while (optind < argc && ndevices < MAX_DEVICES)
+            devices[ndevices++] = argv[optind++];
+    }
+
+    int nthreads = readers + writers;
+    if (readers < 0 || writers < 0 || nthreads == 0 || msg_size == 0 || seconds <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    struct bench_thread *threads = calloc(nthreads, sizeof(*threads));
+    if (!threads) {
+        perror("calloc");
+        return 1;
+    }
+
+    pthread_barrier_init(&start_line, NULL, nthreads + 1);
+
+    for (int i = 0; i < nthreads; i++) {
+        struct bench_thread *t = &threads[i];
+
+        t->id = i;
+        t->is_writer = i >= readers;
+        t->dev = devices[i % ndevices];
+        t->msg_size = msg_size;
+        if (pthread_create(&t->tid, NULL, bench_thread_fn, t)) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    printf("%d readers, %d writers, %zu bytes/op, %d s, %d device(s)%s\n",
+           readers, writers, msg_size, seconds, ndevices, nonblock ? ", O_NONBLOCK" : "");
+
+    pthread_barrier_wait(&start_line);
+    unsigned long long t0 = now_ns();
+    sleep(seconds);
+    atomic_store(&stop, 1);
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(threads[i].tid, NULL);
+    double secs = (now_ns() - t0) / 1e9;
+
+    for (int i = 0; i < nthreads; i++) {
+        if (threads[i].err) {
+            fprintf(stderr, "thread %d (%s on %s): %s\n", i,
+                    threads[i].is_writer ? "writer" : "reader",
+                    threads[i].dev, strerror(threads[i].err));
+            ret = 1;
+        }
+    }
+
+    report("read ", threads, nthreads, 0, secs, verbose);
+    report("write", threads, nthreads, 1, secs, verbose);
+
+    pthread_barrier_destroy(&start_line);
+    free(threads);
+    return ret;
+}
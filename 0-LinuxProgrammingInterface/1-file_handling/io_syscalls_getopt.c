@@ -1,18 +1,217 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <getopt.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define DEFAULT_BLOCK_SIZE (64 * 1024)
 
 void print_usage(const char *prog_name) {
     printf("Usage: %s -f <file> -o <operation> -b <buffer> [-s <offset>]\n", prog_name);
+    printf("       %s -f <file> -o pread|pwrite [-t <threads>] [-z <block>] [-n <size>] [-c <cpu>] [-b <pattern>]\n", prog_name);
     printf("Operations:\n");
     printf("  read\n");
     printf("  write\n");
     printf("  lseek\n");
     printf("  lseek_write\n");
+    printf("  pread        parallel positional read, file split into <threads> ranges\n");
+    printf("  pwrite       parallel positional write of <size> bytes (default: file size)\n");
+    printf("Parallel options:\n");
+    printf("  -t <threads> number of worker threads (default 1)\n");
+    printf("  -z <block>   bytes per pread/pwrite call (default %d, K/M/G suffix allowed)\n", DEFAULT_BLOCK_SIZE);
+    printf("  -n <size>    total bytes to transfer (K/M/G suffix allowed)\n");
+    printf("  -c <cpu>     pin worker i to CPU (cpu + i) %% nr_cpus\n");
+}
+
+/* "4K", "16M", "1G" -> bytes, 0 on a malformed value */
+static unsigned long long parse_size(const char *str) {
+    char *end;
+    unsigned long long val = strtoull(str, &end, 0);
+
+    switch (*end) {
+        case 'k': case 'K': val <<= 10; end++; break;
+        case 'm': case 'M': val <<= 20; end++; break;
+        case 'g': case 'G': val <<= 30; end++; break;
+        default: break;
+    }
+    return *end == '\0' ? val : 0;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Each worker owns [start, start + len) of the file and only ever uses
+ * pread/pwrite, so no thread touches the shared file offset that
+ * lseek/read/write serialize on.
+ */
+struct io_worker {
+    pthread_t tid;
+    int id;
+    int fd;
+    int cpu;                    /* -1 = not pinned */
+    int do_write;
+    off_t start;
+    off_t len;
+    size_t block;
+    const char *pattern;
+    pthread_barrier_t *start_line;
+
+    unsigned long long bytes;
+    unsigned long long calls;
+    double secs;
+    int err;
+};
+
+static void *io_worker_fn(void *arg) {
+    struct io_worker *w = arg;
+    char *buf;
+    off_t off, end = w->start + w->len;
+
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        w->err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (w->err) {
+            fprintf(stderr, "thread %d: cannot pin to cpu %d: %s\n", w->id, w->cpu, strerror(w->err));
+            w->cpu = -1;
+            w->err = 0;
+        }
+    }
+
+    /* page aligned so the same buffer also works with O_DIRECT files */
+    if (posix_memalign((void **)&buf, 4096, w->block)) {
+        w->err = ENOMEM;
+        pthread_barrier_wait(w->start_line);
+        return NULL;
+    }
+    if (w->do_write) {
+        size_t plen = strlen(w->pattern);
+        for (size_t i = 0; i < w->block; i++)
+            buf[i] = plen ? w->pattern[i % plen] : (char)('A' + w->id % 26);
+    }
+
+    pthread_barrier_wait(w->start_line);
+
+    double t0 = now_sec();
+    for (off = w->start; off < end; ) {
+        size_t chunk = (end - off) < (off_t)w->block ? (size_t)(end - off) : w->block;
+        ssize_t ret = w->do_write ? pwrite(w->fd, buf, chunk, off)
+                                  : pread(w->fd, buf, chunk, off);
+        if (ret < 0) {
+            w->err = errno;
+            break;
+        }
+        if (ret == 0)           /* short file on read */
+            break;
+        off += ret;
+        w->bytes += ret;
+        w->calls++;
+    }
+    w->secs = now_sec() - t0;
+
+    free(buf);
+    return NULL;
+}
+
+static int run_parallel(int fd, int do_write, int nthreads, size_t block,
+                        unsigned long long total, int first_cpu, const char *pattern) {
+    struct io_worker *workers;
+    pthread_barrier_t start_line;
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned long long sum_bytes = 0;
+    off_t range;
+    int ret = 0;
+
+    if (total == 0) {
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            perror("fstat");
+            return 1;
+        }
+        total = st.st_size;
+    }
+    if (total == 0) {
+        fprintf(stderr, "nothing to transfer: empty file and no -n <size>\n");
+        return 1;
+    }
+
+    workers = calloc(nthreads, sizeof(*workers));
+    if (!workers) {
+        perror("calloc");
+        return 1;
+    }
+
+    /* block aligned ranges; the last worker takes the remainder */
+    range = (total / nthreads) / block * block;
+    if (range == 0)
+        range = block;
+
+    pthread_barrier_init(&start_line, NULL, nthreads + 1);
+
+    for (int i = 0; i < nthreads; i++) {
+        struct io_worker *w = &workers[i];
+
+        w->id = i;
+        w->fd = fd;
+        w->cpu = first_cpu >= 0 ? (int)((first_cpu + i) % ncpus) : -1;
+        w->do_write = do_write;
+        w->start = (off_t)i * range;
+        w->len = (i == nthreads - 1) ? (off_t)total - w->start : range;
+        if (w->start >= (off_t)total)
+            w->len = 0;
+        else if (w->start + w->len > (off_t)total)
+            w->len = (off_t)total - w->start;
+        w->block = block;
+        w->pattern = pattern ? pattern : "";
+        w->start_line = &start_line;
+
+        if (pthread_create(&w->tid, NULL, io_worker_fn, w)) {
+            perror("pthread_create");
+            exit(1);
+        }
+    }
+
+    /* release all workers at once so the wall clock covers real overlap */
+    pthread_barrier_wait(&start_line);
+    double t0 = now_sec();
+    for (int i = 0; i < nthreads; i++)
+        pthread_join(workers[i].tid, NULL);
+    double wall = now_sec() - t0;
+
+    printf("%-6s %-4s %14s %14s %10s %10s %10s\n",
+           "thread", "cpu", "offset", "bytes", "calls", "secs", "MB/s");
+    for (int i = 0; i < nthreads; i++) {
+        struct io_worker *w = &workers[i];
+        double mbs = w->secs > 0 ? w->bytes / w->secs / (1024 * 1024) : 0;
+
+        if (w->err) {
+            fprintf(stderr, "thread %d: %s\n", i, strerror(w->err));
+            ret = 1;
+        }
+        printf("%-6d %-4d %14lld %14llu %10llu %10.4f %10.1f\n",
+               i, w->cpu, (long long)w->start, w->bytes, w->calls, w->secs, mbs);
+        sum_bytes += w->bytes;
+    }
+    printf("total: %s %llu bytes in %.4f s with %d threads, block %zu -> %.1f MB/s\n",
+           do_write ? "pwrite" : "pread", sum_bytes, wall, nthreads, block,
+           wall > 0 ? sum_bytes / wall / (1024 * 1024) : 0);
+
+    pthread_barrier_destroy(&start_line);
+    free(workers);
+    return ret;
 }
 
 int main(int argc, char *argv[]) {
@@ -20,9 +219,13 @@ int main(int argc, char *argv[]) {
     const char *operation = NULL;
     const char *buffer = NULL;
     int offset = 0;
+    int nthreads = 1;
+    size_t block = DEFAULT_BLOCK_SIZE;
+    unsigned long long total = 0;
+    int first_cpu = -1;
 
     int opt;
-    while ((opt = getopt(argc, argv, "f:o:b:s:")) != -1) {
+    while ((opt = getopt(argc, argv, "f:o:b:s:t:z:n:c:")) != -1) {
         switch (opt) {
             case 'f':
                 file_path = optarg;
@@ -36,17 +239,50 @@ int main(int argc, char *argv[]) {
             case 's':
                 offset = atoi(optarg);
                 break;
+            case 't':
+                nthreads = atoi(optarg);
+                break;
+            case 'z':
+                block = parse_size(optarg);
+                break;
+            case 'n':
+                total = parse_size(optarg);
+                break;
+            case 'c':
+                first_cpu = atoi(optarg);
+                break;
             default:
                 print_usage(argv[0]);
                 return 1;
         }
     }
 
-    if (!file_path || !operation || !buffer) {
+    int parallel = operation && (strcmp(operation, "pread") == 0 ||
+                                 strcmp(operation, "pwrite") == 0);
+
+    if (!file_path || !operation || (!buffer && !parallel)) {
         print_usage(argv[0]);
         return 1;
     }
 
+    if (parallel) {
+        int do_write = strcmp(operation, "pwrite") == 0;
+
+        if (nthreads < 1 || block == 0) {
+            print_usage(argv[0]);
+            return 1;
+        }
+
+        int fd = open(file_path, do_write ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+        if (fd == -1) {
+            perror("open");
+            return 1;
+        }
+        int ret = run_parallel(fd, do_write, nthreads, block, total, first_cpu, buffer);
+        close(fd);
+        return ret;
+    }
+
     int fd = open(file_path, O_RDWR, 0644);
     if (fd == -1) {
         perror("open");
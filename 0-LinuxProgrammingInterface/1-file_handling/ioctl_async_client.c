@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "module/my_ioctl.h"
+
+/*
+ * epoll client for the asynchronous commands of ioctl_kmodule.
+ *
+ * Every device fd gets its own eventfd (IOCTL_SET_EVENTFD), and all eventfds
+ * sit in one epoll set. The loop keeps <qd> MY_OP_RDWR commands in flight per
+ * device: whenever an eventfd fires it reaps the completions of that device
+ * with read() and submits as many new commands as it got back.
+ */
+
+#define MAX_DEVICES 64
+#define REAP_BATCH  64
+
+struct dev_state {
+    const char *path;
+    int fd;
+    int efd;
+    long inflight;
+};
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [-q <depth>] [-S] [-n <commands>] [device ...]\n", prog_name);
+    printf("  -q <depth>     commands in flight per device (1-%d, default 32)\n", MY_ASYNC_MAX_INFLIGHT);
+    printf("  -S             sweep queue depths 1, 2, 4 ... 256\n");
+    printf("  -n <commands>  commands to complete per run (default 1000000)\n");
+    printf("  device ...     device nodes (default /dev/my_device)\n");
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int submit(struct dev_state *d, uint64_t tag) {
+    struct my_sqe sqe;
+
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.user_data = tag;
+    sqe.opcode = MY_OP_RDWR;
+    sqe.data.val1 = (int)tag;
+    if (ioctl(d->fd, IOCTL_SUBMIT_ASYNC, &sqe) != 0)
+        return -1;
+    d->inflight++;
+    return 0;
+}
+
+static int run(struct dev_state *devs, int ndevs, int epfd, int qd, long count) {
+    struct epoll_event events[MAX_DEVICES];
+    struct my_cqe cqes[REAP_BATCH];
+    long submitted = 0, completed = 0, wakeups = 0;
+    uint64_t tag = 0;
+
+    double t0 = now_sec();
+    for (int i = 0; i < ndevs; i++) {
+        for (int q = 0; q < qd && submitted < count; q++, submitted++) {
+            if (submit(&devs[i], tag++) != 0) {
+                perror("IOCTL_SUBMIT_ASYNC");
+                return -1;
+            }
+        }
+    }
+
+    while (completed < count) {
+        int n = epoll_wait(epfd, events, MAX_DEVICES, 1000);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("epoll_wait");
+            return -1;
+        }
+        if (n == 0) {
+            fprintf(stderr, "no completion for 1 s, %ld outstanding\n", submitted - completed);
+            return -1;
+        }
+        wakeups++;
+
+        for (int e = 0; e < n; e++) {
+            struct dev_state *d = &devs[events[e].data.u32];
+            uint64_t ticks;
+
+            /* reset the eventfd counter before reaping so no signal is lost */
+            if (read(d->efd, &ticks, sizeof(ticks)) < 0 && errno != EAGAIN) {
+                perror("read eventfd");
+                return -1;
+            }
+
+            for (;;) {
+                ssize_t got = read(d->fd, cqes, sizeof(cqes));
+                if (got < 0) {
+                    if (errno == EAGAIN)
+                        break;
+                    perror("read completions");
+                    return -1;
+                }
+                for (size_t c = 0; c < got / sizeof(struct my_cqe); c++) {
+                    if (cqes[c].res != 0 || cqes[c].data.val1 != (int)cqes[c].user_data + 10) {
+                        fprintf(stderr, "bad completion %llu\n", (unsigned long long)cqes[c].user_data);
+                        return -1;
+                    }
+                    d->inflight--;
+                    completed++;
+                    if (submitted < count) {
+                        if (submit(d, tag++) != 0) {
+                            perror("IOCTL_SUBMIT_ASYNC");
+                            return -1;
+                        }
+                        submitted++;
+                    }
+                }
+            }
+        }
+    }
+    double secs = now_sec() - t0;
+
+    printf("qd=%3d x %d dev: %ld commands in %.3f s -> %.0f cmd/s, %.1f completions per wakeup\n",
+           qd, ndevs, completed, secs, completed / secs, (double)completed / wakeups);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    struct dev_state devs[MAX_DEVICES];
+    int ndevs = 0;
+    int qd = 32;
+    int sweep = 0;
+    long count = 1000000;
+    int ret = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "q:Sn:")) != -1) {
+        switch (opt) {
+            case 'q':
+                qd = atoi(optarg);
+                break;
+            case 'S':
+                sweep = 1;
+                break;
+            case 'n':
+                count = atol(optarg);
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (qd < 1 || qd > MY_ASYNC_MAX_INFLIGHT || count <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    memset(devs, 0, sizeof(devs));
+    while (optind < argc && ndevs < MAX_DEVICES)
+        devs[ndevs++].path = argv[optind++];
+    if (ndevs == 0)
+        devs[ndevs++].path = "/dev/my_device";
+
+    int epfd = epoll_create1(0);
+    if (epfd < 0) {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    for (int i = 0; i < ndevs; i++) {
+        struct dev_state *d = &devs[i];
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+
+        d->fd = open(d->path, O_RDWR | O_NONBLOCK);
+        if (d->fd < 0) {
+            perror(d->path);
+            return 1;
+        }
+        d->efd = eventfd(0, EFD_NONBLOCK);
+        if (d->efd < 0) {
+            perror("eventfd");
+            return 1;
+        }
+        if (ioctl(d->fd, IOCTL_SET_EVENTFD, &d->efd) != 0) {
+            perror("IOCTL_SET_EVENTFD");
+            return 1;
+        }
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, d->efd, &ev) != 0) {
+            perror("epoll_ctl");
+            return 1;
+        }
+    }
+
+    if (sweep) {
+        for (qd = 1; qd <= 256 && ret == 0; qd *= 2)
+            ret = run(devs, ndevs, epfd, qd, count) ? 1 : 0;
+    } else {
+        ret = run(devs, ndevs, epfd, qd, count) ? 1 : 0;
+    }
+
+    for (int i = 0; i < ndevs; i++) {
+        close(devs[i].fd);
+        close(devs[i].efd);
+    }
+    close(epfd);
+    return ret;
+}
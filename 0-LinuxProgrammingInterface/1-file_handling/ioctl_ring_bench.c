@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include "module/my_ioctl.h"
+
+/*
+ * Compare three ways of pushing MY_OP_RDWR commands into ioctl_kmodule:
+ *   ioctl   one IOCTL_RDWR per command
+ *   ring    batches in the mmapped SQ, one IOCTL_RING_KICK per batch
+ *   sqpoll  batches in the SQ drained by the kernel polling thread,
+ *           IOCTL_RING_KICK only when it went to sleep
+ * and report commands/s plus syscalls per command.
+ */
+
+struct ring {
+    struct my_ring_hdr *hdr;
+    struct my_sqe *sqes;
+    struct my_cqe *cqes;
+    unsigned int mask;
+    unsigned int entries;
+    void *mem;
+    size_t size;
+};
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [-d <device>] [-m ioctl|ring|sqpoll] [-n <commands>] [-q <ring entries>] [-b <batch>] [-c <cpu>]\n", prog_name);
+    printf("  -m <mode>     submission path (default ring)\n");
+    printf("  -n <count>    commands to complete (default 1000000)\n");
+    printf("  -q <entries>  ring size, power of two (default 256)\n");
+    printf("  -b <batch>    commands queued per submission (default = entries)\n");
+    printf("  -c <cpu>      CPU for the SQPOLL kernel thread (default any)\n");
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int ring_init(int fd, struct ring *r, unsigned int entries, int sqpoll, int cpu) {
+    struct my_ring_params p;
+
+    memset(&p, 0, sizeof(p));
+    p.entries = entries;
+    p.flags = sqpoll ? MY_RING_SQPOLL : 0;
+    p.sq_idle_ms = 100;
+    p.sq_cpu = cpu;
+    if (ioctl(fd, IOCTL_RING_SETUP, &p) != 0) {
+        perror("IOCTL_RING_SETUP");
+        return -1;
+    }
+
+    r->mem = mmap(NULL, p.ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (r->mem == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+    r->size = p.ring_size;
+    r->hdr = r->mem;
+    r->sqes = (struct my_sqe *)((char *)r->mem + p.sq_off);
+    r->cqes = (struct my_cqe *)((char *)r->mem + p.cq_off);
+    r->entries = entries;
+    r->mask = entries - 1;
+    return 0;
+}
+
+static long bench_ioctl(int fd, long count, long *syscalls) {
+    struct my_data data = {0, 0};
+
+    for (long i = 0; i < count; i++) {
+        int val1 = data.val1;
+        if (ioctl(fd, IOCTL_RDWR, &data) != 0) {
+            perror("IOCTL_RDWR");
+            return -1;
+        }
+        if (data.val1 != val1 + 10) {
+            fprintf(stderr, "bad result at %ld\n", i);
+            return -1;
+        }
+        (*syscalls)++;
+    }
+    return count;
+}
+
+static long bench_ring(int fd, struct ring *r, long count, unsigned int batch,
+                       int sqpoll, long *syscalls) {
+    long submitted = 0, completed = 0;
+    unsigned int sq_tail = r->hdr->sq_tail;
+    unsigned int cq_head = r->hdr->cq_head;
+
+    while (completed < count) {
+        /* queue up to one batch, never more than the ring has room for */
+        unsigned int inflight = (unsigned int)(submitted - completed);
+        unsigned int n = 0;
+
+        while (n < batch && inflight + n < r->entries && submitted < count) {
+            struct my_sqe *sqe = &r->sqes[sq_tail & r->mask];
+
+            sqe->user_data = submitted;
+            sqe->opcode = MY_OP_RDWR;
+            sqe->data.val1 = (int)submitted;
+            sqe->data.val2 = 0;
+            sq_tail++;
+            submitted++;
+            n++;
+        }
+        if (n) {
+            __atomic_store_n(&r->hdr->sq_tail, sq_tail, __ATOMIC_RELEASE);
+            if (!sqpoll) {
+                (*syscalls)++;
+                if (ioctl(fd, IOCTL_RING_KICK) < 0) {
+                    perror("IOCTL_RING_KICK");
+                    return -1;
+                }
+            }
+        }
+        if (sqpoll) {
+            /* full barrier: our sq_tail store before the flags load */
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            unsigned int flags = __atomic_load_n(&r->hdr->flags, __ATOMIC_RELAXED);
+
+            if (flags & MY_RING_BROKEN) {
+                fprintf(stderr, "SQPOLL thread stopped: ring broken\n");
+                return -1;
+            }
+            if (flags & MY_RING_NEED_WAKEUP) {
+                (*syscalls)++;
+                ioctl(fd, IOCTL_RING_KICK);
+            }
+        }
+
+        /* reap */
+        unsigned int cq_tail = __atomic_load_n(&r->hdr->cq_tail, __ATOMIC_ACQUIRE);
+        while (cq_head != cq_tail) {
+            struct my_cqe *cqe = &r->cqes[cq_head & r->mask];
+
+            if (cqe->res != 0 || cqe->data.val1 != (int)cqe->user_data + 10) {
+                fprintf(stderr, "bad completion for %llu: res=%d val1=%d\n",
+                        (unsigned long long)cqe->user_data, cqe->res, cqe->data.val1);
+                return -1;
+            }
+            cq_head++;
+            completed++;
+        }
+        __atomic_store_n(&r->hdr->cq_head, cq_head, __ATOMIC_RELEASE);
+    }
+    return completed;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dev = "/dev/my_device";
+    const char *mode = "ring";
+    long count = 1000000;
+    unsigned int entries = 256;
+    unsigned int batch = 0;
+    int cpu = -1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:m:n:q:b:c:")) != -1) {
+        switch (opt) {
+            case 'd':
+                dev = optarg;
+                break;
+            case 'm':
+                mode = optarg;
+                break;
+            case 'n':
+                count = atol(optarg);
+                break;
+            case 'q':
+                entries = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                batch = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                cpu = atoi(optarg);
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    int use_ioctl = strcmp(mode, "ioctl") == 0;
+    int sqpoll = strcmp(mode, "sqpoll") == 0;
+    if ((!use_ioctl && !sqpoll && strcmp(mode, "ring") != 0) || count <= 0 ||
+        entries == 0 || (entries & (entries - 1)) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (batch == 0 || batch > entries)
+        batch = entries;
+
+    int fd = open(dev, O_RDWR);
+    if (fd < 0) {
+        perror("Failed to open device");
+        return 1;
+    }
+
+    struct ring r;
+    if (!use_ioctl && ring_init(fd, &r, entries, sqpoll, cpu) != 0) {
+        close(fd);
+        return 1;
+    }
+
+    long syscalls = 0;
+    double t0 = now_sec();
+    long done = use_ioctl ? bench_ioctl(fd, count, &syscalls)
+                          : bench_ring(fd, &r, count, batch, sqpoll, &syscalls);
+    double secs = now_sec() - t0;
+
+    if (done > 0) {
+        printf("%-6s entries=%u batch=%u: %ld commands in %.3f s -> %.0f cmd/s, %ld syscalls (%.4f per cmd)\n",
+               mode, use_ioctl ? 0 : entries, use_ioctl ? 1 : batch, done, secs,
+               done / secs, syscalls, (double)syscalls / done);
+    }
+
+    if (!use_ioctl)
+        munmap(r.mem, r.size);
+    close(fd);
+    return done > 0 ? 0 : 1;
+}
@@ -1,21 +1,32 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
 #include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "module/my_ioctl.h"
 
-#define DEVICE_TYPE 'M' // Unique identifier for the device
+#define MAX_DEVICES 64
 
-// Define ioctl commands
-#define IOCTL_READ  _IOR(DEVICE_TYPE, 1, int)       // Read an integer
-#define IOCTL_WRITE _IOW(DEVICE_TYPE, 2, int)       // Write an integer
-#define IOCTL_RDWR  _IOWR(DEVICE_TYPE, 3, struct my_data) // Read/Write struct
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [-d <device>]...               single-shot demo\n", prog_name);
+    printf("       %s -p <procs> [-n <ioctls>] [-d <device>]...\n", prog_name);
+    printf("  -d <device>  device node, may be repeated (default /dev/my_device)\n");
+    printf("  -p <procs>   fork <procs> processes, each opens its own fd (round robin over -d)\n");
+    printf("               and issues <ioctls> IOCTL_RDWR calls\n");
+    printf("  -n <ioctls>  ioctls per process (default 1000000)\n");
+}
 
-struct my_data {
-    int val1;
-    int val2;
-};
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-int main() {
-    int fd = open("/dev/my_device", O_RDWR);
+static int demo(const char *dev) {
+    int fd = open(dev, O_RDWR);
     if (fd < 0) {
         perror("Failed to open device");
         return 1;
@@ -23,6 +34,7 @@ int main() {
 
     int value = 0;
     struct my_data data = {10, 20};
+    struct my_stats stats;
 
     // Read an integer
     if (ioctl(fd, IOCTL_READ, &value) == 0) {
@@ -40,6 +52,116 @@ int main() {
         printf("Modified data: val1=%d, val2=%d\n", data.val1, data.val2);
     }
 
+    // Statistics of this open file only
+    if (ioctl(fd, IOCTL_GET_STATS, &stats) == 0) {
+        printf("Stats: minor=%d value=%d read=%llu write=%llu rdwr=%llu\n",
+               stats.minor, stats.value, (unsigned long long)stats.nr_read,
+               (unsigned long long)stats.nr_write, (unsigned long long)stats.nr_rdwr);
+    }
+
     close(fd);
     return 0;
-}
\ No newline at end of file
+}
+
+/* child: hammer IOCTL_RDWR on a private fd, return ops/s through the pipe */
+static void bench_child(const char *dev, long iters, int out) {
+    struct my_data data = {0, 0};
+    double rate = -1;
+    int fd = open(dev, O_RDWR);
+
+    if (fd >= 0) {
+        double t0 = now_sec();
+        long i;
+        for (i = 0; i < iters; i++) {
+            if (ioctl(fd, IOCTL_RDWR, &data) != 0)
+                break;
+        }
+        double secs = now_sec() - t0;
+        if (i == iters && secs > 0)
+            rate = iters / secs;
+        else
+            perror("ioctl");
+        close(fd);
+    } else {
+        perror("open");
+    }
+
+    if (write(out, &rate, sizeof(rate)) != sizeof(rate))
+        _exit(1);
+    _exit(rate < 0);
+}
+
+static int bench(const char **devs, int ndevs, int procs, long iters) {
+    int pipefd[2];
+    double total = 0;
+    int ret = 0;
+
+    if (pipe(pipefd) == -1) {
+        perror("pipe");
+        return 1;
+    }
+
+    double t0 = now_sec();
+    for (int i = 0; i < procs; i++) {
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            close(pipefd[0]);
+            bench_child(devs[i % ndevs], iters, pipefd[1]);
+        }
+    }
+    close(pipefd[1]);
+
+    for (int i = 0; i < procs; i++) {
+        double rate;
+        if (read(pipefd[0], &rate, sizeof(rate)) != sizeof(rate) || rate < 0) {
+            ret = 1;
+            continue;
+        }
+        printf("proc %2d: %.0f ioctl/s\n", i, rate);
+        total += rate;
+    }
+    while (wait(NULL) > 0)
+        ;
+    double wall = now_sec() - t0;
+
+    printf("%d procs x %ld IOCTL_RDWR: sum %.0f ioctl/s, wall %.3f s (%.0f ioctl/s)\n",
+           procs, iters, total, wall, procs * iters / wall);
+    close(pipefd[0]);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    const char *devs[MAX_DEVICES];
+    int ndevs = 0;
+    int procs = 0;
+    long iters = 1000000;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:p:n:")) != -1) {
+        switch (opt) {
+            case 'd':
+                if (ndevs < MAX_DEVICES)
+                    devs[ndevs++] = optarg;
+                break;
+            case 'p':
+                procs = atoi(optarg);
+                break;
+            case 'n':
+                iters = atol(optarg);
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (ndevs == 0)
+        devs[ndevs++] = "/dev/my_device";
+
+    if (procs > 0)
+        return bench(devs, ndevs, procs, iters);
+    return demo(devs[0]);
+}
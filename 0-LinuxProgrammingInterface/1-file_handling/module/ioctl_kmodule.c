@@ -2,69 +2,610 @@
 #include <linux/fs.h>
 #include <linux/uaccess.h>
 #include <linux/cdev.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/atomic.h>
+#include <linux/mutex.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/jiffies.h>
+#include <linux/log2.h>
+#include <linux/workqueue.h>
+#include <linux/eventfd.h>
+#include <linux/kfifo.h>
+#include <linux/wait.h>
+#include <linux/version.h>
+#include "my_ioctl.h"
 
 #define DEVICE_NAME "my_device"
-#define DEVICE_TYPE 'M' // Unique identifier for the device
+#define MAX_MINORS  64
 
-// Define ioctl commands
-#define IOCTL_READ  _IOR(DEVICE_TYPE, 1, int)       // Read an integer
-#define IOCTL_WRITE _IOW(DEVICE_TYPE, 2, int)       // Write an integer
-#define IOCTL_RDWR  _IOWR(DEVICE_TYPE, 3, struct my_data) // Read/Write struct
+static unsigned int nr_minors = 4;
+module_param(nr_minors, uint, 0444);
+MODULE_PARM_DESC(nr_minors, "Number of minors to register (1-64)");
 
+static bool verbose;
+module_param(verbose, bool, 0644);
+MODULE_PARM_DESC(verbose, "Log every ioctl (slow, serializes on the console)");
 
-struct my_data {
-    int val1;
-    int val2;
+/* one per minor, found again in open() through inode->i_cdev */
+struct my_device {
+    struct cdev cdev;
+    int minor;
+    atomic_t open_count;
 };
+
+/*
+ * Command/completion rings of one open file, see my_ioctl.h for the layout
+ * and the protocol. sq_head/cq_tail are the kernel's own copies: they are
+ * only ever written out to the shared header, never read back from it.
+ */
+struct my_ring {
+    void *mem;              /* vmalloc_user(), mapped by device_mmap() */
+    size_t size;
+    struct my_ring_hdr *hdr;
+    struct my_sqe *sqes;
+    struct my_cqe *cqes;
+    u32 entries;
+    u32 mask;
+    u32 sq_head;
+    u32 cq_tail;
+    struct task_struct *sq_thread;  /* MY_RING_SQPOLL only */
+    unsigned long sq_idle;          /* jiffies */
+};
+
+/*
+ * One per open(), hung off file->private_data. Everything an ioctl touches
+ * lives here, so processes that opened the device separately never share a
+ * lock or a cache line (the cache is SLAB_HWCACHE_ALIGN).
+ */
+struct my_file_ctx {
+    struct my_device *dev;
+    spinlock_t lock;        /* only contended if one fd is shared by threads */
+    int value;
+    u64 nr_read;
+    u64 nr_write;
+    u64 nr_rdwr;
+
+    struct mutex ring_lock; /* ring/async setup and ring draining */
+    struct my_ring *ring;
+
+    /* asynchronous commands, set up on the first IOCTL_SUBMIT_ASYNC */
+    bool async_ready;
+    spinlock_t async_lock;  /* async_done and evfd */
+    DECLARE_KFIFO_PTR(async_done, struct my_cqe);
+    struct eventfd_ctx *evfd;
+    atomic_t async_inflight; /* submitted and not yet read() back */
+    wait_queue_head_t async_wait;
+};
+
+/* one queued IOCTL_SUBMIT_ASYNC */
+struct my_async_cmd {
+    struct work_struct work;
+    struct my_file_ctx *ctx;
+    struct my_sqe sqe;
+};
+
 static int device_open(struct inode *, struct file *);
 static int device_release(struct inode *, struct file *);
 static long device_ioctl(struct file *, unsigned int, unsigned long);
+static int device_mmap(struct file *, struct vm_area_struct *);
+static ssize_t device_read(struct file *, char __user *, size_t, loff_t *);
 
 static struct file_operations fops = {
+    .owner = THIS_MODULE,
     .open = device_open,
     .release = device_release,
     .unlocked_ioctl = device_ioctl,
+    .mmap = device_mmap,
+    .read = device_read,
 };
 
-static struct cdev c_dev;
+static struct my_device *devs;
+static struct kmem_cache *ctx_cache;
+static struct kmem_cache *cmd_cache;
+static struct workqueue_struct *async_wq;
 static dev_t dev_num;
 
 static int __init example_init(void) {
-    if (alloc_chrdev_region(&dev_num, 0, 1, DEVICE_NAME) < 0) {
-        return -1;
+    int i, ret;
+
+    if (nr_minors < 1 || nr_minors > MAX_MINORS) {
+        pr_err("nr_minors must be 1-%d\n", MAX_MINORS);
+        return -EINVAL;
+    }
+
+    ctx_cache = kmem_cache_create("my_device_ctx", sizeof(struct my_file_ctx),
+                                  0, SLAB_HWCACHE_ALIGN, NULL);
+    if (!ctx_cache)
+        return -ENOMEM;
+
+    cmd_cache = KMEM_CACHE(my_async_cmd, 0);
+    if (!cmd_cache) {
+        ret = -ENOMEM;
+        goto err_cache;
+    }
+
+    async_wq = alloc_workqueue("my_device_async", 0, 0);
+    if (!async_wq) {
+        ret = -ENOMEM;
+        goto err_cmd_cache;
+    }
+
+    devs = kcalloc(nr_minors, sizeof(*devs), GFP_KERNEL);
+    if (!devs) {
+        ret = -ENOMEM;
+        goto err_wq;
     }
-    cdev_init(&c_dev, &fops);
-    if (cdev_add(&c_dev, dev_num, 1) == -1) {
-        unregister_chrdev_region(dev_num, 1);
-        return -1;
+
+    ret = alloc_chrdev_region(&dev_num, 0, nr_minors, DEVICE_NAME);
+    if (ret < 0)
+        goto err_devs;
+
+    for (i = 0; i < nr_minors; i++) {
+        devs[i].minor = i;
+        atomic_set(&devs[i].open_count, 0);
+        cdev_init(&devs[i].cdev, &fops);
+        devs[i].cdev.owner = THIS_MODULE;
+        ret = cdev_add(&devs[i].cdev, MKDEV(MAJOR(dev_num), i), 1);
+        if (ret < 0) {
+            while (--i >= 0)
+                cdev_del(&devs[i].cdev);
+            goto err_region;
+        }
     }
-    printk(KERN_INFO "Example device registered with major %d\n", MAJOR(dev_num));
+
+    printk(KERN_INFO "Example device registered with major %d, %u minors\n",
+           MAJOR(dev_num), nr_minors);
     return 0;
+
+err_region:
+    unregister_chrdev_region(dev_num, nr_minors);
+err_devs:
+    kfree(devs);
+err_wq:
+    destroy_workqueue(async_wq);
+err_cmd_cache:
+    kmem_cache_destroy(cmd_cache);
+err_cache:
+    kmem_cache_destroy(ctx_cache);
+    return ret;
 }
 
 static void __exit example_exit(void) {
-    cdev_del(&c_dev);
-    unregister_chrdev_region(dev_num, 1);
+    int i;
+
+    for (i = 0; i < nr_minors; i++)
+        cdev_del(&devs[i].cdev);
+    unregister_chrdev_region(dev_num, nr_minors);
+    kfree(devs);
+    destroy_workqueue(async_wq);
+    kmem_cache_destroy(cmd_cache);
+    kmem_cache_destroy(ctx_cache);
     printk(KERN_INFO "Example device unregistered\n");
 }
 
 static int device_open(struct inode *inode, struct file *file) {
-    printk(KERN_INFO "Device opened\n");
+    struct my_device *dev = container_of(inode->i_cdev, struct my_device, cdev);
+    struct my_file_ctx *ctx;
+
+    ctx = kmem_cache_zalloc(ctx_cache, GFP_KERNEL);
+    if (!ctx)
+        return -ENOMEM;
+
+    ctx->dev = dev;
+    spin_lock_init(&ctx->lock);
+    mutex_init(&ctx->ring_lock);
+    spin_lock_init(&ctx->async_lock);
+    atomic_set(&ctx->async_inflight, 0);
+    init_waitqueue_head(&ctx->async_wait);
+    ctx->value = 42; // Example: IOCTL_READ returns 42 until something is written
+    file->private_data = ctx;
+
+    atomic_inc(&dev->open_count);
+    printk(KERN_INFO "Device %d opened\n", dev->minor);
     return 0;
 }
 
+static void ring_free(struct my_ring *r) {
+    if (r->sq_thread)
+        kthread_stop(r->sq_thread);
+    vfree(r->mem);
+    kfree(r);
+}
+
 static int device_release(struct inode *inode, struct file *file) {
-    printk(KERN_INFO "Device closed\n");
+    struct my_file_ctx *ctx = file->private_data;
+
+    /* the mapping holds a file reference, so nobody can still use the ring */
+    if (ctx->ring)
+        ring_free(ctx->ring);
+
+    /* no new submissions can come in: wait for the queued ones to finish */
+    if (ctx->async_ready) {
+        flush_workqueue(async_wq);
+        kfifo_free(&ctx->async_done);
+    }
+    if (ctx->evfd)
+        eventfd_ctx_put(ctx->evfd);
+
+    atomic_dec(&ctx->dev->open_count);
+    printk(KERN_INFO "Device %d closed: read=%llu write=%llu rdwr=%llu\n",
+           ctx->dev->minor, ctx->nr_read, ctx->nr_write, ctx->nr_rdwr);
+    kmem_cache_free(ctx_cache, ctx);
+    return 0;
+}
+
+/* one command, shared by the ioctl path and the ring path */
+static int my_exec(struct my_file_ctx *ctx, u32 opcode, struct my_data *data) {
+    int ret = 0;
+
+    spin_lock(&ctx->lock);
+    switch (opcode) {
+        case MY_OP_READ:
+            data->val1 = ctx->value;
+            ctx->nr_read++;
+            break;
+
+        case MY_OP_WRITE:
+            ctx->value = data->val1;
+            ctx->nr_write++;
+            break;
+
+        case MY_OP_RDWR:
+            data->val1 += 10; // Modify the data
+            data->val2 += 20;
+            ctx->nr_rdwr++;
+            break;
+
+        default:
+            ret = -EINVAL;
+    }
+    spin_unlock(&ctx->lock);
+
+    return ret;
+}
+
+/*
+ * Move every submitted command that has a free completion slot from the SQ
+ * to the CQ. Called with ring_lock held. A full CQ simply stops the drain:
+ * the remaining sqes stay queued until userspace reaps completions.
+ */
+static int ring_drain(struct my_file_ctx *ctx) {
+    struct my_ring *r = ctx->ring;
+    struct my_ring_hdr *hdr = r->hdr;
+    u32 sq_tail = smp_load_acquire(&hdr->sq_tail);
+    u32 cq_head = smp_load_acquire(&hdr->cq_head);
+    u32 sq_head = r->sq_head;
+    u32 cq_tail = r->cq_tail;
+    int done = 0;
+
+    /* head/tail live in user memory: never trust them further than this */
+    if (sq_tail - sq_head > r->entries || cq_tail - cq_head > r->entries)
+        return -EINVAL;
+
+    while (sq_head != sq_tail && cq_tail - cq_head < r->entries) {
+        struct my_sqe sqe = r->sqes[sq_head & r->mask];
+        struct my_cqe cqe = {
+            .user_data = sqe.user_data,
+            .data = sqe.data,
+        };
+
+        cqe.res = my_exec(ctx, sqe.opcode, &cqe.data);
+        r->cqes[cq_tail & r->mask] = cqe;
+        sq_head++;
+        cq_tail++;
+        done++;
+    }
+
+    r->sq_head = sq_head;
+    r->cq_tail = cq_tail;
+    smp_store_release(&hdr->sq_head, sq_head);
+    smp_store_release(&hdr->cq_tail, cq_tail);
+    return done;
+}
+
+static int ring_sq_thread(void *arg) {
+    struct my_file_ctx *ctx = arg;
+    struct my_ring *r = ctx->ring;
+    unsigned long idle_until = jiffies + r->sq_idle;
+
+    while (!kthread_should_stop()) {
+        int done;
+
+        mutex_lock(&ctx->ring_lock);
+        done = ring_drain(ctx);
+        mutex_unlock(&ctx->ring_lock);
+
+        if (done < 0) {
+            /*
+             * Bad sq_tail/cq_head from userspace: say so and stop polling.
+             * Only a kick (the submitter may have repaired its tails) or
+             * teardown gets us to look at the ring again.
+             */
+            set_current_state(TASK_INTERRUPTIBLE);
+            WRITE_ONCE(r->hdr->flags, MY_RING_BROKEN | MY_RING_NEED_WAKEUP);
+            if (!kthread_should_stop())
+                schedule();
+            __set_current_state(TASK_RUNNING);
+            WRITE_ONCE(r->hdr->flags, 0);
+            idle_until = jiffies + r->sq_idle;
+            continue;
+        }
+
+        if (done > 0 || time_before(jiffies, idle_until)) {
+            if (done > 0)
+                idle_until = jiffies + r->sq_idle;
+            cond_resched();
+            continue;
+        }
+
+        /*
+         * Idle: ask for a kick, then look at sq_tail
+         * once more. Pairs with the barrier between the submitter's sq_tail
+         * store and its flags load, so a submission is never missed.
+         */
+        set_current_state(TASK_INTERRUPTIBLE);
+        WRITE_ONCE(r->hdr->flags, MY_RING_NEED_WAKEUP);
+        smp_mb();
+        if (READ_ONCE(r->hdr->sq_tail) == r->sq_head && !kthread_should_stop())
+            schedule();
+        __set_current_state(TASK_RUNNING);
+        WRITE_ONCE(r->hdr->flags, 0);
+        idle_until = jiffies + r->sq_idle;
+    }
+
     return 0;
 }
 
+static int ring_setup(struct my_file_ctx *ctx, struct my_ring_params *p) {
+    struct my_ring *r;
+    size_t sq_off, cq_off;
+    int ret;
+
+    if (!p->entries || p->entries > MY_RING_MAX_ENTRIES || !is_power_of_2(p->entries))
+        return -EINVAL;
+    if (p->flags & ~MY_RING_SQPOLL)
+        return -EINVAL;
+    if ((p->flags & MY_RING_SQPOLL) && p->sq_cpu >= 0 &&
+        (p->sq_cpu >= nr_cpu_ids || !cpu_online(p->sq_cpu)))
+        return -EINVAL;
+
+    mutex_lock(&ctx->ring_lock);
+    if (ctx->ring) {
+        ret = -EBUSY;
+        goto out_unlock;
+    }
+
+    r = kzalloc(sizeof(*r), GFP_KERNEL);
+    if (!r) {
+        ret = -ENOMEM;
+        goto out_unlock;
+    }
+
+    sq_off = sizeof(struct my_ring_hdr);
+    cq_off = sq_off + p->entries * sizeof(struct my_sqe);
+    r->size = PAGE_ALIGN(cq_off + p->entries * sizeof(struct my_cqe));
+    r->mem = vmalloc_user(r->size);
+    if (!r->mem) {
+        kfree(r);
+        ret = -ENOMEM;
+        goto out_unlock;
+    }
+    r->hdr = r->mem;
+    r->sqes = r->mem + sq_off;
+    r->cqes = r->mem + cq_off;
+    r->entries = p->entries;
+    r->mask = p->entries - 1;
+    r->sq_idle = msecs_to_jiffies(p->sq_idle_ms ? p->sq_idle_ms : 1000);
+    ctx->ring = r;
+
+    if (p->flags & MY_RING_SQPOLL) {
+        struct task_struct *t;
+
+        t = kthread_create(ring_sq_thread, ctx, "my_dev%d_sq", ctx->dev->minor);
+        if (IS_ERR(t)) {
+            ctx->ring = NULL;
+            vfree(r->mem);
+            kfree(r);
+            ret = PTR_ERR(t);
+            goto out_unlock;
+        }
+        if (p->sq_cpu >= 0)
+            kthread_bind(t, p->sq_cpu);
+        r->sq_thread = t;
+        wake_up_process(t);
+    }
+
+    p->sq_off = sq_off;
+    p->cq_off = cq_off;
+    p->ring_size = r->size;
+    ret = 0;
+
+out_unlock:
+    mutex_unlock(&ctx->ring_lock);
+    return ret;
+}
+
+static int ring_kick(struct my_file_ctx *ctx) {
+    struct my_ring *r;
+    int ret;
+
+    mutex_lock(&ctx->ring_lock);
+    r = ctx->ring;
+    if (!r) {
+        ret = -ENXIO;
+    } else if (r->sq_thread) {
+        wake_up_process(r->sq_thread);
+        ret = 0;
+    } else {
+        ret = ring_drain(ctx);
+    }
+    mutex_unlock(&ctx->ring_lock);
+
+    return ret;
+}
+
+static void async_cmd_work(struct work_struct *work) {
+    struct my_async_cmd *cmd = container_of(work, struct my_async_cmd, work);
+    struct my_file_ctx *ctx = cmd->ctx;
+    struct my_cqe cqe = {
+        .user_data = cmd->sqe.user_data,
+        .data = cmd->sqe.data,
+    };
+    unsigned long flags;
+
+    cqe.res = my_exec(ctx, cmd->sqe.opcode, &cqe.data);
+    kmem_cache_free(cmd_cache, cmd);
+
+    /* cannot overflow: async_inflight keeps us below the fifo size */
+    spin_lock_irqsave(&ctx->async_lock, flags);
+    kfifo_put(&ctx->async_done, cqe);
+    if (ctx->evfd)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+        eventfd_signal(ctx->evfd);
+#else
+        eventfd_signal(ctx->evfd, 1);
+#endif
+    spin_unlock_irqrestore(&ctx->async_lock, flags);
+
+    /* release() flushes async_wq before freeing ctx, so this is safe */
+    wake_up(&ctx->async_wait);
+}
+
+static int async_init(struct my_file_ctx *ctx) {
+    int ret = 0;
+
+    mutex_lock(&ctx->ring_lock);
+    if (!ctx->async_ready) {
+        ret = kfifo_alloc(&ctx->async_done, MY_ASYNC_MAX_INFLIGHT, GFP_KERNEL);
+        if (!ret)
+            smp_store_release(&ctx->async_ready, true);
+    }
+    mutex_unlock(&ctx->ring_lock);
+
+    return ret;
+}
+
+static int async_submit(struct my_file_ctx *ctx, const struct my_sqe __user *usqe) {
+    struct my_async_cmd *cmd;
+    int ret;
+
+    if (!smp_load_acquire(&ctx->async_ready)) {
+        ret = async_init(ctx);
+        if (ret)
+            return ret;
+    }
+
+    if (atomic_inc_return(&ctx->async_inflight) > MY_ASYNC_MAX_INFLIGHT) {
+        atomic_dec(&ctx->async_inflight);
+        return -EAGAIN;
+    }
+
+    cmd = kmem_cache_alloc(cmd_cache, GFP_KERNEL);
+    if (!cmd) {
+        ret = -ENOMEM;
+        goto err;
+    }
+    if (copy_from_user(&cmd->sqe, usqe, sizeof(cmd->sqe))) {
+        kmem_cache_free(cmd_cache, cmd);
+        ret = -EFAULT;
+        goto err;
+    }
+    cmd->ctx = ctx;
+    INIT_WORK(&cmd->work, async_cmd_work);
+    queue_work(async_wq, &cmd->work);
+    return 0;
+
+err:
+    atomic_dec(&ctx->async_inflight);
+    return ret;
+}
+
+static int async_set_eventfd(struct my_file_ctx *ctx, int __user *ufd) {
+    struct eventfd_ctx *new = NULL, *old;
+    unsigned long flags;
+    int efd;
+
+    if (get_user(efd, ufd))
+        return -EFAULT;
+    if (efd >= 0) {
+        new = eventfd_ctx_fdget(efd);
+        if (IS_ERR(new))
+            return PTR_ERR(new);
+    }
+
+    spin_lock_irqsave(&ctx->async_lock, flags);
+    old = ctx->evfd;
+    ctx->evfd = new;
+    spin_unlock_irqrestore(&ctx->async_lock, flags);
+
+    if (old)
+        eventfd_ctx_put(old);
+    return 0;
+}
+
+/* reap asynchronous completions, whole struct my_cqe only */
+static ssize_t device_read(struct file *file, char __user *buf, size_t len, loff_t *off) {
+    struct my_file_ctx *ctx = file->private_data;
+    struct my_cqe cqes[16];
+    size_t copied = 0;
+    int ret;
+
+    if (len < sizeof(struct my_cqe))
+        return -EINVAL;
+    if (!smp_load_acquire(&ctx->async_ready))
+        return -EAGAIN;
+
+    if (!(file->f_flags & O_NONBLOCK)) {
+        ret = wait_event_interruptible(ctx->async_wait, !kfifo_is_empty(&ctx->async_done));
+        if (ret)
+            return ret;
+    }
+
+    while (len - copied >= sizeof(struct my_cqe)) {
+        unsigned int want = min_t(size_t, (len - copied) / sizeof(struct my_cqe), ARRAY_SIZE(cqes));
+        unsigned int n = kfifo_out_spinlocked(&ctx->async_done, cqes, want, &ctx->async_lock);
+
+        if (n == 0)
+            break;
+        atomic_sub(n, &ctx->async_inflight);
+        if (copy_to_user(buf + copied, cqes, n * sizeof(struct my_cqe)))
+            return -EFAULT;
+        copied += n * sizeof(struct my_cqe);
+    }
+
+    return copied ? copied : -EAGAIN;
+}
+
+static int device_mmap(struct file *file, struct vm_area_struct *vma) {
+    struct my_file_ctx *ctx = file->private_data;
+    int ret;
+
+    mutex_lock(&ctx->ring_lock);
+    if (!ctx->ring)
+        ret = -ENXIO;
+    else
+        ret = remap_vmalloc_range(vma, ctx->ring->mem, vma->vm_pgoff);
+    mutex_unlock(&ctx->ring_lock);
+
+    return ret;
+}
+
 static long device_ioctl(struct file *file, unsigned int cmd, unsigned long arg) {
+    struct my_file_ctx *ctx = file->private_data;
     int value;
+    long ret;
     struct my_data data;
+    struct my_stats stats;
+    struct my_ring_params params;
 
     switch (cmd) {
         case IOCTL_READ:
-            value = 42; // Example: return 42
+            my_exec(ctx, MY_OP_READ, &data);
+            value = data.val1;
             if (copy_to_user((int __user *)arg, &value, sizeof(value))) {
                 return -EFAULT;
             }
@@ -74,22 +615,60 @@ static long device_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
             if (copy_from_user(&value, (int __user *)arg, sizeof(value))) {
                 return -EFAULT;
             }
-            pr_info("Value written by user: %d\n", value);
+            data.val1 = value;
+            my_exec(ctx, MY_OP_WRITE, &data);
+            if (verbose)
+                pr_info("Value written by user: %d\n", value);
             break;
 
         case IOCTL_RDWR:
             if (copy_from_user(&data, (struct my_data __user *)arg, sizeof(data))) {
                 return -EFAULT;
             }
-            pr_info("Data received: val1=%d, val2=%d\n", data.val1, data.val2);
+            if (verbose)
+                pr_info("Data received: val1=%d, val2=%d\n", data.val1, data.val2);
 
-            data.val1 += 10; // Modify the data
-            data.val2 += 20;
+            my_exec(ctx, MY_OP_RDWR, &data);
             if (copy_to_user((struct my_data __user *)arg, &data, sizeof(data))) {
                 return -EFAULT;
             }
             break;
 
+        case IOCTL_GET_STATS:
+            memset(&stats, 0, sizeof(stats));
+            spin_lock(&ctx->lock);
+            stats.nr_read = ctx->nr_read;
+            stats.nr_write = ctx->nr_write;
+            stats.nr_rdwr = ctx->nr_rdwr;
+            stats.value = ctx->value;
+            spin_unlock(&ctx->lock);
+            stats.minor = ctx->dev->minor;
+            if (copy_to_user((struct my_stats __user *)arg, &stats, sizeof(stats))) {
+                return -EFAULT;
+            }
+            break;
+
+        case IOCTL_RING_SETUP:
+            if (copy_from_user(&params, (struct my_ring_params __user *)arg, sizeof(params))) {
+                return -EFAULT;
+            }
+            ret = ring_setup(ctx, &params);
+            if (ret)
+                return ret;
+            if (copy_to_user((struct my_ring_params __user *)arg, &params, sizeof(params))) {
+                return -EFAULT;
+            }
+            break;
+
+        case IOCTL_RING_KICK:
+            return ring_kick(ctx);
+
+        case IOCTL_SET_EVENTFD:
+            return async_set_eventfd(ctx, (int __user *)arg);
+
+        case IOCTL_SUBMIT_ASYNC:
+            return async_submit(ctx, (const struct my_sqe __user *)arg);
+
         default:
             return -EINVAL;
     }
@@ -102,4 +681,4 @@ MODULE_AUTHOR("Example Author");
 MODULE_DESCRIPTION("Example ioctl device driver");
 
 module_init(example_init);
-module_exit(example_exit);
\ No newline at end of file
+module_exit(example_exit);
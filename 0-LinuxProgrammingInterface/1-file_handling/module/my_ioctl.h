@@ -0,0 +1,118 @@
+#ifndef MY_IOCTL_H
+#define MY_IOCTL_H
+
+/*
+ * ioctl interface of ioctl_kmodule, shared by the module and the user apps
+ * (ioctl_userApp.c includes it as "module/my_ioctl.h").
+ */
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+#define DEVICE_TYPE 'M' // Unique identifier for the device
+
+struct my_data {
+    int val1;
+    int val2;
+};
+
+/* per open file statistics, see IOCTL_GET_STATS */
+struct my_stats {
+    __u64 nr_read;
+    __u64 nr_write;
+    __u64 nr_rdwr;
+    __s32 minor;     /* minor this fd was opened on */
+    __s32 value;     /* last value stored with IOCTL_WRITE */
+};
+
+// Define ioctl commands
+#define IOCTL_READ      _IOR(DEVICE_TYPE, 1, int)             // Read an integer
+#define IOCTL_WRITE     _IOW(DEVICE_TYPE, 2, int)             // Write an integer
+#define IOCTL_RDWR      _IOWR(DEVICE_TYPE, 3, struct my_data) // Read/Write struct
+#define IOCTL_GET_STATS _IOR(DEVICE_TYPE, 4, struct my_stats) // Per file statistics
+
+/*
+ * Shared memory command/completion rings (io_uring style).
+ *
+ * IOCTL_RING_SETUP allocates one ring per open file and returns its layout;
+ * userspace then mmaps params.ring_size bytes at offset 0:
+ *
+ *   0          struct my_ring_hdr
+ *   sq_off     struct my_sqe[entries]   filled by userspace
+ *   cq_off     struct my_cqe[entries]   filled by the kernel
+ *
+ * Userspace writes sqes, then publishes sq_tail (store-release). The kernel
+ * consumes them on IOCTL_RING_KICK, or continuously from a polling kthread
+ * with MY_RING_SQPOLL, and publishes cq_tail. Heads/tails are free running
+ * u32 counters, index = counter & (entries - 1).
+ *
+ * With MY_RING_SQPOLL the kthread goes to sleep after sq_idle_ms without
+ * work and sets MY_RING_NEED_WAKEUP; a submitter that sees the flag (after a
+ * full barrier following its sq_tail store) must call IOCTL_RING_KICK.
+ * If sq_tail or cq_head is ever more than entries away from the kernel's
+ * head/tail the kthread sets MY_RING_BROKEN and stops polling until the
+ * next kick; without SQPOLL the kick itself fails with EINVAL.
+ */
+#define MY_OP_READ   1   /* cqe.data.val1 = stored value */
+#define MY_OP_WRITE  2   /* stored value = sqe.data.val1 */
+#define MY_OP_RDWR   3   /* same as IOCTL_RDWR */
+
+struct my_sqe {
+    __u64 user_data;     /* copied to the cqe untouched */
+    __u32 opcode;        /* MY_OP_* */
+    __u32 pad;
+    struct my_data data;
+};
+
+struct my_cqe {
+    __u64 user_data;
+    __s32 res;           /* 0 or -errno */
+    __u32 pad;
+    struct my_data data;
+};
+
+struct my_ring_hdr {
+    /* written by the kernel */
+    __u32 sq_head;
+    __u32 cq_tail;
+    __u32 flags;         /* MY_RING_NEED_WAKEUP, MY_RING_BROKEN */
+    /* written by userspace, kept on its own cache line */
+    __u32 sq_tail __attribute__((aligned(64)));
+    __u32 cq_head;
+} __attribute__((aligned(64)));
+
+#define MY_RING_SQPOLL       (1U << 0)   /* my_ring_params.flags */
+#define MY_RING_NEED_WAKEUP  (1U << 0)   /* my_ring_hdr.flags */
+#define MY_RING_BROKEN       (1U << 1)   /* my_ring_hdr.flags, SQPOLL stopped */
+#define MY_RING_MAX_ENTRIES  4096
+
+struct my_ring_params {
+    __u32 entries;       /* in: power of two, <= MY_RING_MAX_ENTRIES */
+    __u32 flags;         /* in: MY_RING_SQPOLL */
+    __u32 sq_idle_ms;    /* in: SQPOLL thread sleeps after this long idle */
+    __s32 sq_cpu;        /* in: CPU to bind the SQPOLL thread to, -1 = any */
+    __u32 sq_off;        /* out: offset of the sqe array in the mapping */
+    __u32 cq_off;        /* out: offset of the cqe array in the mapping */
+    __u32 ring_size;     /* out: bytes to mmap at offset 0 */
+    __u32 pad;
+};
+
+#define IOCTL_RING_SETUP _IOWR(DEVICE_TYPE, 5, struct my_ring_params)
+#define IOCTL_RING_KICK  _IO(DEVICE_TYPE, 6)   // returns commands completed, 0 with SQPOLL
+
+/*
+ * Asynchronous commands.
+ *
+ * IOCTL_SUBMIT_ASYNC queues one struct my_sqe to a workqueue and returns at
+ * once. When it has run, a struct my_cqe is queued on the file and the
+ * eventfd registered with IOCTL_SET_EVENTFD (if any) is signalled, so one
+ * epoll loop can wait on many devices. Completions are reaped with read()
+ * in multiples of sizeof(struct my_cqe); read() blocks unless O_NONBLOCK.
+ * At most MY_ASYNC_MAX_INFLIGHT commands may be submitted and not yet
+ * reaped, beyond that IOCTL_SUBMIT_ASYNC fails with EAGAIN.
+ */
+#define MY_ASYNC_MAX_INFLIGHT 1024
+
+#define IOCTL_SET_EVENTFD  _IOW(DEVICE_TYPE, 7, int)             // eventfd to signal, -1 to remove
+#define IOCTL_SUBMIT_ASYNC _IOW(DEVICE_TYPE, 8, struct my_sqe)   // queue one command
+
+#endif /* MY_IOCTL_H */
@@ -3,49 +3,134 @@
 #include <linux/hrtimer.h>
 #include <linux/ktime.h>
 #include <linux/spinlock.h>
+#include <linux/smp.h>
+#include <linux/tick.h>
+#include <linux/kernel_stat.h>
 
 static unsigned long interval_ns = 20 * 1000 * 1000; /* 20 ms default */
 module_param(interval_ns, ulong, 0644);
 MODULE_PARM_DESC(interval_ns, "Timer period in nanoseconds");
 
-static struct hrtimer my_timer;
+static unsigned long slack_ns;
+module_param(slack_ns, ulong, 0444);
+MODULE_PARM_DESC(slack_ns, "Allowed delay of each expiry, lets the kernel coalesce wakeups (0 = exact)");
+
+#define MAX_JOBS 16
+
+static unsigned int nr_jobs = 1;
+module_param(nr_jobs, uint, 0444);
+MODULE_PARM_DESC(nr_jobs, "Logical periodic jobs, same period, phases spread over it (1-16)");
+
+static bool batch;
+module_param(batch, bool, 0444);
+MODULE_PARM_DESC(batch, "Run all jobs from one shared timer instead of one timer each");
+
+/* one logical periodic job, e.g. the poll routine of one driver */
+struct demo_job {
+    struct hrtimer timer;   /* own timer, unused in batch mode */
+    ktime_t next;           /* deadline of the next run */
+    u64 runs;
+};
+
+static struct hrtimer my_timer; /* shared timer of batch mode */
+static struct demo_job jobs[MAX_JOBS];
 static ktime_t period;
 
 static spinlock_t stats_lock;
 static u64 timer_fires;
+static u64 timer_wakeups;
+static u64 last_wakeup_ns;
 static u64 work_counter;
 
 static u64 max_cs_ns;
 static u64 total_cs_ns;
 static u64 cs_count;
 
-static enum hrtimer_restart my_timer_callback(struct hrtimer *t)
+static u64 max_late_ns;
+static u64 total_late_ns;
+
+/* where the timers are pinned, and its counters when they started */
+static int timer_cpu;
+static u64 run_start_ns;
+static u64 start_idle_us;
+static unsigned long start_irqs;
+
+static void run_job(struct demo_job *job, ktime_t now)
 {
     unsigned long flags;
     u64 start_ns, end_ns, duration;
-    u64 now_ns = ktime_to_ns(ktime_get());
+    u64 late = ktime_to_ns(ktime_sub(now, job->next));
 
     /* measure from just before taking the lock to just after releasing it */
     start_ns = ktime_get_ns();
 
     spin_lock_irqsave(&stats_lock, flags); // disable interrupts while holding the lock, to avoid deadlocks
-    timer_fires++; // increment timer fire count
     work_counter += 10; // simulate some work
+    if (late > max_late_ns)
+        max_late_ns = late;
+    total_late_ns += late;
     spin_unlock_irqrestore(&stats_lock, flags); // restore interrupt state
 
     end_ns = ktime_get_ns();
     duration = end_ns - start_ns;
 
-    /* update stats without extra locking: stats_lock already protects them */
+    /* update stats without extra locking: all timers are pinned to one CPU */
     if (duration > max_cs_ns)
         max_cs_ns = duration;
     total_cs_ns += duration;
     cs_count++;
 
+    /* skip the deadlines we slept through, like hrtimer_forward_now() */
+    job->runs++;
+    do
+        job->next = ktime_add(job->next, period);
+    while (ktime_compare(job->next, now) <= 0);
+}
+
+/*
+ * Every expiry is a fire. Expiries within slack_ns of the last counted
+ * wakeup are the ones the kernel lets share it, so they don't count as
+ * wakeups of their own, whatever number of jobs each one runs.
+ */
+static void count_fire(ktime_t now)
+{
+    u64 now_ns = ktime_to_ns(now);
+
+    timer_fires++; // increment timer fire count
+    if (!timer_wakeups || now_ns - last_wakeup_ns > slack_ns) {
+        timer_wakeups++;
+        last_wakeup_ns = now_ns;
+    }
+
     if ((timer_fires % 1000) == 0) {
         u64 avg = cs_count ? (total_cs_ns / cs_count) : 0;
-        pr_info("spin_hrtimer_demo: fires=%llu work=%llu now=%llu ns cs_max=%lluns cs_avg=%lluns\n",
-                timer_fires, work_counter, now_ns, max_cs_ns, avg);
+        pr_info("spin_hrtimer_demo: fires=%llu wakeups=%llu work=%llu now=%llu ns cs_max=%lluns cs_avg=%lluns\n",
+                timer_fires, timer_wakeups, work_counter, now_ns, max_cs_ns, avg);
+    }
+}
+
+static enum hrtimer_restart job_timer_callback(struct hrtimer *t)
+{
+    struct demo_job *job = container_of(t, struct demo_job, timer);
+    ktime_t now = ktime_get();
+
+    count_fire(now);
+    run_job(job, now);
+
+    /* moves the soft and the hard expiry together, so the slack is kept */
+    hrtimer_forward_now(t, period);
+    return HRTIMER_RESTART;
+}
+
+static enum hrtimer_restart my_timer_callback(struct hrtimer *t)
+{
+    ktime_t now = ktime_get();
+    unsigned int i;
+
+    count_fire(now);
+    for (i = 0; i < nr_jobs; i++) {
+        if (ktime_compare(jobs[i].next, now) <= 0)
+            run_job(&jobs[i], now);
     }
 
     hrtimer_forward_now(&my_timer, period);
@@ -54,19 +139,49 @@ static enum hrtimer_restart my_timer_callback(struct hrtimer *t)
 
 static int __init spin_hrtimer_demo_init(void)
 {
-	pr_info("spin_hrtimer_demo: init, period=%lu ns\n", interval_ns);
+	ktime_t first;
+	unsigned int i;
 
-	spin_lock_init(&stats_lock); // initialize the spinlock
+	if (!interval_ns || nr_jobs < 1 || nr_jobs > MAX_JOBS)
+		return -EINVAL;
 
-	period = ktime_set(0, interval_ns); // seconds, nanoseconds
+	pr_info("spin_hrtimer_demo: init, period=%lu ns slack=%lu ns jobs=%u %s\n",
+		interval_ns, slack_ns, nr_jobs, batch ? "batched on one timer" : "one timer each");
 
-	hrtimer_init(&my_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED); // use pinned mode to avoid migration, which can skew timing
-	my_timer.function = my_timer_callback; // set the callback function
+	spin_lock_init(&stats_lock); // initialize the spinlock
+
+	period = ns_to_ktime(interval_ns);
 
 	timer_fires = 0;
+	timer_wakeups = 0;
 	work_counter = 0;
 
-	hrtimer_start(&my_timer, period, HRTIMER_MODE_REL_PINNED); // start the timer
+	/* the timers are pinned: start them all from the same CPU, and watch that CPU */
+	timer_cpu = get_cpu();
+	run_start_ns = ktime_get_ns();
+	start_idle_us = get_cpu_idle_time_us(timer_cpu, NULL);
+	start_irqs = kstat_cpu_irqs_sum(timer_cpu);
+
+	/* absolute deadlines, job i shifted by i/nr_jobs of a period */
+	first = ktime_add(ktime_get(), period);
+	for (i = 0; i < nr_jobs; i++)
+		jobs[i].next = ktime_add_ns(first, div_u64((u64)interval_ns * i, nr_jobs));
+
+	if (batch) {
+		/* fire when the last job is due: every tick runs all of them */
+		hrtimer_init(&my_timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_PINNED); // use pinned mode to avoid migration, which can skew timing
+		my_timer.function = my_timer_callback; // set the callback function
+		hrtimer_start_range_ns(&my_timer, jobs[nr_jobs - 1].next, slack_ns,
+				       HRTIMER_MODE_ABS_PINNED);
+	} else {
+		for (i = 0; i < nr_jobs; i++) {
+			hrtimer_init(&jobs[i].timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS_PINNED);
+			jobs[i].timer.function = job_timer_callback;
+			hrtimer_start_range_ns(&jobs[i].timer, jobs[i].next, slack_ns,
+					       HRTIMER_MODE_ABS_PINNED);
+		}
+	}
+	put_cpu();
 
 	return 0;
 }
@@ -74,23 +189,62 @@ static int __init spin_hrtimer_demo_init(void)
 static void __exit spin_hrtimer_demo_exit(void)
 {
     unsigned long flags;
-    u64 fires, work, max_cs, total_cs, count, avg;
+    u64 fires, wakeups, work, max_cs, total_cs, count, avg, max_late, total_late;
+    u64 wall_ns, idle_us, runs = 0;
+    unsigned long irqs;
+    unsigned int i;
+
+    if (batch) {
+        if (hrtimer_cancel(&my_timer))
+            pr_info("spin_hrtimer_demo: timer was active, cancelled now\n");
+    } else {
+        for (i = 0; i < nr_jobs; i++)
+            hrtimer_cancel(&jobs[i].timer);
+    }
 
-    if (hrtimer_cancel(&my_timer))
-        pr_info("spin_hrtimer_demo: timer was active, cancelled now\n");
+    wall_ns = ktime_get_ns() - run_start_ns;
+    idle_us = get_cpu_idle_time_us(timer_cpu, NULL);
+    irqs = kstat_cpu_irqs_sum(timer_cpu) - start_irqs;
 
     spin_lock_irqsave(&stats_lock, flags); // protect stats during readout
     fires   = timer_fires;
+    wakeups = timer_wakeups;
     work    = work_counter;
     max_cs  = max_cs_ns;
     total_cs = total_cs_ns;
     count   = cs_count;
+    max_late = max_late_ns;
+    total_late = total_late_ns;
     spin_unlock_irqrestore(&stats_lock, flags); // restore interrupt state
 
+    for (i = 0; i < nr_jobs; i++)
+        runs += jobs[i].runs;
+
     avg = count ? (total_cs / count) : 0;
 
     pr_info("spin_hrtimer_demo: exit fires=%llu work=%llu cs_max=%lluns cs_avg=%lluns samples=%llu\n",
             fires, work, max_cs, avg, count);
+    pr_info("spin_hrtimer_demo: %llu job runs, lateness avg=%lluns max=%lluns (slack=%lu ns, %s)\n",
+            runs, runs ? div64_u64(total_late, runs) : 0, max_late, slack_ns,
+            batch ? "batched" : "one timer per job");
+
+    if (wall_ns < NSEC_PER_MSEC)
+        return;
+    pr_info("spin_hrtimer_demo: cpu%d over %llu ms: %llu timer fires/s, %llu wakeups/s, %llu irqs/s",
+            timer_cpu, div_u64(wall_ns, NSEC_PER_MSEC), div64_u64(fires * NSEC_PER_SEC, wall_ns),
+            div64_u64(wakeups * NSEC_PER_SEC, wall_ns), div64_u64((u64)irqs * NSEC_PER_SEC, wall_ns));
+    /*
+     * Total idle time, all C-states together, not the residency per state
+     * (cpuidle keeps that in a per-CPU device modules can't reach, see sysfs).
+     * -1 when NO_HZ idle accounting is not active.
+     */
+    if (start_idle_us != (u64)-1 && idle_us != (u64)-1) {
+        u32 permille = div64_u64((idle_us - start_idle_us) * 1000 * NSEC_PER_USEC, wall_ns);
+
+        pr_cont(", idle %u.%u%%\n", permille / 10, permille % 10);
+    } else {
+        pr_cont("\n");
+    }
 }
 
 
@@ -0,0 +1,277 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/wait.h>
+#include <linux/atomic.h>
+#include "kworker_pool.h"
+
+/*
+ * Worker pool with work stealing.
+ *
+ * Every online CPU at load time gets a worker: a kthread bound to it and a
+ * deque of kwp_work items. The owner pops the newest item from the tail
+ * (still hot in its cache), an idle worker steals the oldest half of
+ * another deque from the head. The deques are lists under a per-worker
+ * spinlock, so submission works from any context, IRQs included.
+ *
+ * A worker with nothing to run or steal sleeps. Submitting wakes the target
+ * worker if it sleeps, or one sleeping worker if the target is busy and has
+ * a backlog, so the backlog gets stolen.
+ *
+ * CPUs brought online later get no worker; kwp_submit() from such a CPU
+ * uses the first worker.
+ */
+
+struct kwp_worker {
+	spinlock_t lock;
+	struct list_head deque;         /* owner pops the tail, thieves the head */
+	unsigned int nr;
+	bool idle;                      /* sleeping, or about to */
+	int cpu;
+	struct task_struct *task;
+
+	/* owner only */
+	u64 executed;
+	u64 steals;
+	u64 stolen;
+	u64 steal_misses;
+};
+
+static DEFINE_PER_CPU_ALIGNED(struct kwp_worker, workers);
+static struct cpumask pool_cpus;
+static atomic_t nr_idle;
+static atomic_long_t pending;           /* submitted, not finished yet */
+static DECLARE_WAIT_QUEUE_HEAD(flush_wq);
+
+static void kwp_push(struct kwp_worker *w, struct kwp_work *work)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&w->lock, flags);
+	list_add_tail(&work->entry, &w->deque);
+	WRITE_ONCE(w->nr, w->nr + 1);
+	spin_unlock_irqrestore(&w->lock, flags);
+}
+
+static struct kwp_work *kwp_pop(struct kwp_worker *w)
+{
+	struct kwp_work *work = NULL;
+	unsigned long flags;
+
+	if (!READ_ONCE(w->nr))
+		return NULL;
+
+	spin_lock_irqsave(&w->lock, flags);
+	if (w->nr) {
+		work = list_last_entry(&w->deque, struct kwp_work, entry);
+		list_del_init(&work->entry);
+		WRITE_ONCE(w->nr, w->nr - 1);
+	}
+	spin_unlock_irqrestore(&w->lock, flags);
+	return work;
+}
+
+/* move the oldest half of the first non-empty deque after ours to ours */
+static unsigned int kwp_steal(struct kwp_worker *self)
+{
+	LIST_HEAD(loot);
+	unsigned long flags;
+	unsigned int taken = 0;
+	int cpu;
+
+	for_each_cpu_wrap(cpu, &pool_cpus, self->cpu + 1) {
+		struct kwp_worker *v = per_cpu_ptr(&workers, cpu);
+		unsigned int i;
+
+		if (v == self || !READ_ONCE(v->nr))
+			continue;
+
+		spin_lock_irqsave(&v->lock, flags);
+		taken = (v->nr + 1) / 2;
+		for (i = 0; i < taken; i++)
+			list_move_tail(v->deque.next, &loot);
+		WRITE_ONCE(v->nr, v->nr - taken);
+		spin_unlock_irqrestore(&v->lock, flags);
+
+		if (taken)
+			break;
+	}
+
+	if (!taken) {
+		self->steal_misses++;
+		return 0;
+	}
+
+	spin_lock_irqsave(&self->lock, flags);
+	list_splice_tail(&loot, &self->deque);
+	WRITE_ONCE(self->nr, self->nr + taken);
+	spin_unlock_irqrestore(&self->lock, flags);
+
+	self->steals++;
+	self->stolen += taken;
+	return taken;
+}
+
+/* anything queued anywhere: ours to run or to steal */
+static bool kwp_work_visible(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu, &pool_cpus) {
+		if (READ_ONCE(per_cpu_ptr(&workers, cpu)->nr))
+			return true;
+	}
+	return false;
+}
+
+static void kwp_run(struct kwp_worker *w, struct kwp_work *work)
+{
+	/* the item may be resubmitted or freed from func: don't touch it after */
+	work->func(work);
+	w->executed++;
+	if (atomic_long_dec_and_test(&pending))
+		wake_up_all(&flush_wq);
+}
+
+static int kwp_worker_fn(void *arg)
+{
+	struct kwp_worker *w = arg;
+
+	while (!kthread_should_stop()) {
+		struct kwp_work *work = kwp_pop(w);
+
+		if (!work && kwp_steal(w))
+			work = kwp_pop(w);
+		if (work) {
+			kwp_run(w, work);
+			cond_resched();
+			continue;
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		WRITE_ONCE(w->idle, true);
+		atomic_inc(&nr_idle);
+		/* idle store before the deque checks, pairs with kwp_kick() */
+		smp_mb();
+		if (!kwp_work_visible() && !kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+		atomic_dec(&nr_idle);
+		WRITE_ONCE(w->idle, false);
+	}
+	return 0;
+}
+
+static void kwp_kick(struct kwp_worker *w)
+{
+	int cpu;
+
+	/* item pushed before the idle check, pairs with kwp_worker_fn() */
+	smp_mb();
+	if (READ_ONCE(w->idle)) {
+		wake_up_process(w->task);
+		return;
+	}
+
+	/* the owner is busy: wake somebody to steal the backlog */
+	if (!atomic_read(&nr_idle) || READ_ONCE(w->nr) < 2)
+		return;
+	for_each_cpu_wrap(cpu, &pool_cpus, w->cpu + 1) {
+		struct kwp_worker *v = per_cpu_ptr(&workers, cpu);
+
+		if (READ_ONCE(v->idle)) {
+			wake_up_process(v->task);
+			return;
+		}
+	}
+}
+
+int kwp_submit_on(int cpu, struct kwp_work *work)
+{
+	struct kwp_worker *w;
+
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpumask_test_cpu(cpu, &pool_cpus))
+		return -EINVAL;
+
+	w = per_cpu_ptr(&workers, cpu);
+	atomic_long_inc(&pending);
+	kwp_push(w, work);
+	kwp_kick(w);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(kwp_submit_on);
+
+int kwp_submit(struct kwp_work *work)
+{
+	/* only a hint: being migrated right after is harmless */
+	int cpu = raw_smp_processor_id();
+
+	if (!cpumask_test_cpu(cpu, &pool_cpus))
+		cpu = cpumask_first(&pool_cpus);
+	return kwp_submit_on(cpu, work);
+}
+EXPORT_SYMBOL_GPL(kwp_submit);
+
+void kwp_flush(void)
+{
+	wait_event(flush_wq, !atomic_long_read(&pending));
+}
+EXPORT_SYMBOL_GPL(kwp_flush);
+
+static void kwp_stop_all(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu, &pool_cpus) {
+		struct kwp_worker *w = per_cpu_ptr(&workers, cpu);
+
+		kthread_stop(w->task);
+		pr_info("cpu%d: %llu executed, %llu stolen in %llu steals, %llu empty steal scans\n",
+			cpu, w->executed, w->stolen, w->steals, w->steal_misses);
+	}
+	cpumask_clear(&pool_cpus);
+}
+
+static int __init kworker_pool_init(void)
+{
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		struct kwp_worker *w = per_cpu_ptr(&workers, cpu);
+
+		spin_lock_init(&w->lock);
+		INIT_LIST_HEAD(&w->deque);
+		w->cpu = cpu;
+		w->task = kthread_create_on_cpu(kwp_worker_fn, w, cpu, "kwp/%u");
+		if (IS_ERR(w->task)) {
+			int ret = PTR_ERR(w->task);
+
+			kwp_stop_all();
+			return ret;
+		}
+		cpumask_set_cpu(cpu, &pool_cpus);
+		wake_up_process(w->task);
+	}
+
+	pr_info("%u workers\n", cpumask_weight(&pool_cpus));
+	return 0;
+}
+
+static void __exit kworker_pool_exit(void)
+{
+	/* users hold a reference on us: nothing can be queued any more */
+	kwp_stop_all();
+}
+
+module_init(kworker_pool_init);
+module_exit(kworker_pool_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Per-CPU kthread worker pool with work stealing");
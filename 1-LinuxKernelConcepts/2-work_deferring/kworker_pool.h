@@ -0,0 +1,41 @@
+#ifndef KWORKER_POOL_H
+#define KWORKER_POOL_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+/*
+ * API of kworker_pool: one pinned kthread per online CPU, each with its own
+ * deque of work items. Items submitted to a CPU run on its worker unless an
+ * idle worker steals them first.
+ *
+ * Users:
+ *  - kworker_pool_bench
+ *
+ * A work item is embedded in the caller's struct, like a work_struct, and
+ * must not be submitted again before its func has started. func runs in
+ * process context and may sleep, but sleeping holds up that CPU's deque
+ * until somebody steals from it.
+ */
+struct kwp_work {
+	struct list_head entry;
+	void (*func)(struct kwp_work *work);
+};
+
+static inline void kwp_init_work(struct kwp_work *work,
+				 void (*func)(struct kwp_work *work))
+{
+	INIT_LIST_HEAD(&work->entry);
+	work->func = func;
+}
+
+/* queue on the worker of the current CPU; callable from any context */
+int kwp_submit(struct kwp_work *work);
+
+/* queue on the worker of @cpu; -EINVAL if that CPU has no worker */
+int kwp_submit_on(int cpu, struct kwp_work *work);
+
+/* wait until every item submitted so far has run */
+void kwp_flush(void);
+
+#endif /* KWORKER_POOL_H */
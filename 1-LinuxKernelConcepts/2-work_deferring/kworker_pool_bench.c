@@ -0,0 +1,180 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/workqueue.h>
+#include <linux/completion.h>
+#include <linux/atomic.h>
+#include <linux/percpu.h>
+#include <linux/cpumask.h>
+#include <linux/vmalloc.h>
+#include <linux/ktime.h>
+#include <linux/sched/clock.h>
+#include "kworker_pool.h"
+
+/*
+ * Throughput of fine-grained CPU-bound items on three executors:
+ *
+ *   kwp          kworker_pool, kwp_submit_on()
+ *   wq_percpu    a per-CPU workqueue, queue_work_on()
+ *   wq_unbound   a WQ_UNBOUND workqueue, queue_work()
+ *
+ * Each item spins for work_ns. Items are submitted from the insmod thread
+ * either round-robin over the online CPUs ("spread") or all to the CPU of
+ * the submitter ("local"), the second one being where stealing matters.
+ */
+
+static unsigned int nr_items = 200000;
+module_param(nr_items, uint, 0444);
+MODULE_PARM_DESC(nr_items, "Work items per run");
+
+static unsigned int work_ns = 1000;
+module_param(work_ns, uint, 0444);
+MODULE_PARM_DESC(work_ns, "Busy time of one item");
+
+enum backend { B_KWP, B_WQ_PERCPU, B_WQ_UNBOUND, NR_BACKENDS };
+
+static const char * const backend_names[NR_BACKENDS] = {
+	"kwp", "wq_percpu", "wq_unbound",
+};
+
+struct bench_item {
+	struct kwp_work kw;
+	struct work_struct ws;
+};
+
+static struct bench_item *items;
+static struct workqueue_struct *percpu_wq;
+static struct workqueue_struct *unbound_wq;
+static atomic_t remaining;
+static DECLARE_COMPLETION(all_done);
+static DEFINE_PER_CPU(unsigned long, ran);
+
+static void item_body(void)
+{
+	u64 end = local_clock() + work_ns;
+
+	while (local_clock() < end)
+		cpu_relax();
+
+	this_cpu_inc(ran);
+	if (atomic_dec_and_test(&remaining))
+		complete(&all_done);
+}
+
+static void kwp_item_fn(struct kwp_work *kw)
+{
+	item_body();
+}
+
+static void wq_item_fn(struct work_struct *ws)
+{
+	item_body();
+}
+
+static void run_one(enum backend b, bool local)
+{
+	unsigned long min_ran = ULONG_MAX, max_ran = 0;
+	u64 t0, submit_ns, total_ns;
+	int cpu = cpumask_first(cpu_online_mask), home;
+	unsigned int i;
+
+	for_each_possible_cpu(home)
+		per_cpu(ran, home) = 0;
+	atomic_set(&remaining, nr_items);
+	reinit_completion(&all_done);
+	home = raw_smp_processor_id();
+
+	t0 = ktime_get_ns();
+	for (i = 0; i < nr_items; i++) {
+		struct bench_item *it = &items[i];
+		int target = local ? home : cpu;
+
+		switch (b) {
+		case B_KWP:
+			kwp_init_work(&it->kw, kwp_item_fn);
+			if (kwp_submit_on(target, &it->kw))
+				kwp_submit(&it->kw);
+			break;
+		case B_WQ_PERCPU:
+			INIT_WORK(&it->ws, wq_item_fn);
+			queue_work_on(target, percpu_wq, &it->ws);
+			break;
+		default:
+			INIT_WORK(&it->ws, wq_item_fn);
+			queue_work(unbound_wq, &it->ws);
+			break;
+		}
+
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+	}
+	submit_ns = ktime_get_ns() - t0;
+
+	if (!wait_for_completion_timeout(&all_done, 60 * HZ))
+		pr_warn("%s: %d items still pending after 60 s\n",
+			backend_names[b], atomic_read(&remaining));
+	/* nothing may still be queued when the item array is reused */
+	if (b == B_KWP)
+		kwp_flush();
+	else
+		flush_workqueue(b == B_WQ_PERCPU ? percpu_wq : unbound_wq);
+	total_ns = ktime_get_ns() - t0;
+
+	for_each_online_cpu(cpu) {
+		min_ran = min(min_ran, per_cpu(ran, cpu));
+		max_ran = max(max_ran, per_cpu(ran, cpu));
+	}
+
+	pr_info("%-10s %-6s: %u items in %llu us -> %llu items/s, submit %llu ns/item, per-CPU items min %lu max %lu\n",
+		backend_names[b], local ? "local" : "spread", nr_items,
+		div_u64(total_ns, NSEC_PER_USEC),
+		div64_u64((u64)nr_items * NSEC_PER_SEC, total_ns ? : 1),
+		div_u64(submit_ns, nr_items), min_ran, max_ran);
+}
+
+static int __init kworker_pool_bench_init(void)
+{
+	int ret = -ENOMEM;
+
+	if (!nr_items)
+		return -EINVAL;
+
+	items = vzalloc(array_size(nr_items, sizeof(*items)));
+	if (!items)
+		return -ENOMEM;
+	percpu_wq = alloc_workqueue("kwp_bench", 0, 0);
+	if (!percpu_wq)
+		goto err_items;
+	unbound_wq = alloc_workqueue("kwp_bench_unbound", WQ_UNBOUND, 0);
+	if (!unbound_wq)
+		goto err_percpu;
+
+	pr_info("%u CPUs online, %u items of %u ns\n", num_online_cpus(), nr_items, work_ns);
+	run_one(B_KWP, false);
+	run_one(B_WQ_PERCPU, false);
+	run_one(B_WQ_UNBOUND, false);
+	run_one(B_KWP, true);
+	run_one(B_WQ_PERCPU, true);
+
+	ret = 0;
+	destroy_workqueue(unbound_wq);
+err_percpu:
+	destroy_workqueue(percpu_wq);
+err_items:
+	vfree(items);
+	return ret;
+}
+
+static void __exit kworker_pool_bench_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(kworker_pool_bench_init);
+module_exit(kworker_pool_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("kworker_pool against per-CPU and unbound workqueues");
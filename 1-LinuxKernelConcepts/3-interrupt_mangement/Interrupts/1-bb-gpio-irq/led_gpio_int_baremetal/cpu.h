@@ -0,0 +1,134 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * The few CPSR / CP15 operations the firmware needs, in one place, so the
+ * host build (HOST_SIM, see ../../am335x-sim) can replace them.
+ */
+
+#define CPU_MHZ 1000u   /* AM335x on the BeagleBone Black: CCNT counts 1 GHz */
+
+/*
+ * Interrupt hot path placement, on-chip SRAM (linker.ld, copied by reset):
+ * __fast for code, __fast_data for initialised data, __fast_bss for data
+ * that starts zeroed.
+ */
+#ifndef HOST_SIM
+#define __fast      __attribute__((section(".fast_text")))
+#define __fast_data __attribute__((section(".fast_data")))
+#define __fast_bss  __attribute__((section(".fast_bss")))
+#else
+#define __fast
+#define __fast_data
+#define __fast_bss
+#endif
+
+#ifndef HOST_SIM
+
+/* PMU cycle counter on, no divider, from 0 */
+static inline void cpu_cycles_init(void)
+{
+    uint32_t pmcr;
+
+    asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    pmcr |= (1u << 0) | (1u << 2);          /* E, C: enable, reset CCNT */
+    pmcr &= ~(1u << 3);                     /* D: count every cycle */
+    asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r"(pmcr));
+    asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r"(1u << 31));   /* PMCNTENSET.C */
+}
+
+static inline uint32_t cpu_cycles(void)
+{
+    uint32_t c;
+
+    asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r"(c));
+    return c;
+}
+
+/* event counters 0 and 1 count ev0 and ev1 (ARMv7 PMU event numbers), from 0 */
+static inline void cpu_pmu_events_init(uint32_t ev0, uint32_t ev1)
+{
+    uint32_t pmcr;
+
+    asm volatile ("mcr p15, 0, %0, c9, c12, 5" : : "r"(0));        /* PMSELR */
+    asm volatile ("isb");
+    asm volatile ("mcr p15, 0, %0, c9, c13, 1" : : "r"(ev0));      /* PMXEVTYPER */
+    asm volatile ("mcr p15, 0, %0, c9, c12, 5" : : "r"(1));
+    asm volatile ("isb");
+    asm volatile ("mcr p15, 0, %0, c9, c13, 1" : : "r"(ev1));
+
+    asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    pmcr |= (1u << 1);                      /* P: reset event counters */
+    asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r"(pmcr));
+    asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r"(3u));       /* PMCNTENSET.P0, P1 */
+}
+
+/* event counter n; select + read with IRQs off, an ISR may select another */
+static inline uint32_t cpu_pmu_event(uint32_t n)
+{
+    uint32_t cpsr, v;
+
+    asm volatile ("mrs %0, cpsr\n\tcpsid i" : "=r"(cpsr) : : "memory");
+    asm volatile ("mcr p15, 0, %0, c9, c12, 5" : : "r"(n));        /* PMSELR */
+    asm volatile ("isb");
+    asm volatile ("mrc p15, 0, %0, c9, c13, 2" : "=r"(v));         /* PMXEVCNTR */
+    asm volatile ("msr cpsr_c, %0" : : "r"(cpsr) : "memory");
+    return v;
+}
+
+static inline void cpu_irq_disable(void)
+{
+    asm volatile ("cpsid i" : : : "memory");
+}
+
+static inline void cpu_irq_enable(void)
+{
+    asm volatile ("cpsie i" : : : "memory");
+}
+
+static inline void cpu_wfi(void)
+{
+    asm volatile ("wfi" : : : "memory");
+}
+
+static inline void cpu_dsb(void)
+{
+    asm volatile ("dsb" : : : "memory");
+}
+
+static inline uint32_t cpu_get_cpsr(void)
+{
+    uint32_t cpsr;
+
+    asm volatile ("mrs %0, cpsr" : "=r"(cpsr));
+    return cpsr;
+}
+
+static inline const uint32_t *cpu_get_vbar(void)
+{
+    uint32_t vbar;
+
+    asm volatile ("mrc p15, 0, %0, c12, c0, 0" : "=r"(vbar));
+    return (const uint32_t *)vbar;
+}
+
+static inline void cpu_set_vbar(const uint32_t *vectors)
+{
+    asm volatile ("mcr p15, 0, %0, c12, c0, 0" : : "r"(vectors));
+}
+
+#else
+
+static inline void cpu_cycles_init(void) { }
+static inline uint32_t cpu_cycles(void) { return (uint32_t)(sim_cycles_ns() * CPU_MHZ / 1000); }
+static inline void cpu_pmu_events_init(uint32_t ev0, uint32_t ev1) { (void)ev0; (void)ev1; }
+static inline uint32_t cpu_pmu_event(uint32_t n) { (void)n; return 0; }
+static inline void cpu_irq_disable(void) { sim_cpu_irq_enable(0); }
+static inline void cpu_irq_enable(void) { sim_cpu_irq_enable(1); }
+static inline void cpu_dsb(void) { }
+/* SVC mode, I bit as the model has it */
+static inline uint32_t cpu_get_cpsr(void) { return 0x13u | (sim_cpu_irq_enabled() ? 0 : 0x80u); }
+static inline const uint32_t *cpu_get_vbar(void) { return (const uint32_t *)sim_vbar; }
+static inline void cpu_set_vbar(const uint32_t *vectors) { sim_vbar = vectors; }
+
+#endif
@@ -0,0 +1,77 @@
+#include <stdint.h>
+#include "evlog.h"
+#include "uart.h"
+#include "sched.h"
+
+struct ev_rec evlog_ring[EVLOG_SIZE] __fast_bss;
+volatile uint32_t evlog_claim __fast_bss;
+volatile uint32_t evlog_tail __fast_bss;
+volatile uint32_t evlog_lost __fast_bss;
+
+static uint32_t reported_lost;
+static uint32_t last_ts;
+
+/* longest line below, so a decoded event is never cut by a full UART ring */
+#define EV_LINE_MAX 64
+
+static void ev_print(const struct ev_rec *r)
+{
+    uart_puts("[+");
+    print_dec_u32((r->ts - last_ts) / CPU_MHZ);
+    uart_puts("us] ");
+    last_ts = r->ts;
+
+    switch (r->code) {
+    case EV_IRQ_UNKNOWN:
+        uart_puts("[IRQ] source: UNKNOWN irq=");
+        print_dec_u32(r->irq);
+        uart_puts(", masked");
+        break;
+    case EV_BUTTON:
+        uart_puts(r->arg ? "[GPIO] Button PRESSED - LED OFF" : "[GPIO] Button RELEASED - LED ON");
+        break;
+    case EV_TICK:
+        uart_puts("[TIMER] tick #");
+        print_dec_u32(r->arg);
+        break;
+    case EV_TASK_OVERRUN:
+        uart_puts("[SCHED] task ");
+        uart_puts(sched_task_name(r->irq));
+        uart_puts(" over budget: ");
+        print_dec_u32(r->arg / CPU_MHZ);
+        uart_puts("us");
+        break;
+    default:
+        uart_puts("[LOG] bad record code=");
+        print_dec_u32(r->code);
+        break;
+    }
+    uart_putc('\n');
+}
+
+uint32_t evlog_drain(void)
+{
+    uint32_t n = 0;
+
+    while (uart_tx_room() >= 2 * EV_LINE_MAX) {
+        uint32_t lost = evlog_lost;
+        uint32_t tail = evlog_tail;
+        struct ev_rec *r = &evlog_ring[tail & EVLOG_MASK];
+
+        if (lost != reported_lost) {
+            uart_puts("[LOG] ");
+            print_dec_u32(lost - reported_lost);
+            uart_puts(" events lost\n");
+            reported_lost = lost;
+        }
+
+        /* claimed but not written yet: its ISR was interrupted */
+        if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != tail + 1)
+            break;
+
+        ev_print(r);
+        __atomic_store_n(&evlog_tail, tail + 1, __ATOMIC_RELEASE);
+        n++;
+    }
+    return n;
+}
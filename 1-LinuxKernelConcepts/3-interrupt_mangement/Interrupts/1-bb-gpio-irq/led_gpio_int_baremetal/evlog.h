@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "cpu.h"
+
+/*
+ * Binary event log: ISRs record what happened, the main loop prints it.
+ *
+ * Logging is a claim (ldrex/strex), four stores and a release store of the
+ * sequence number, no UART involved. evlog_drain() turns the records into
+ * the text the ISRs used to print, from the main loop, as far as the UART
+ * ring has room. A full log drops the new record and counts it.
+ */
+
+enum ev_code {
+    EV_IRQ_UNKNOWN,     /* no handler for irq, now masked */
+    EV_BUTTON,          /* arg = 1 pressed (LED off), 0 released (LED on) */
+    EV_TICK,            /* arg = timer_ticks */
+    EV_TASK_OVERRUN,    /* irq = task id (sched.h), arg = cycles run so far */
+    EV_NR
+};
+
+struct ev_rec {
+    uint32_t seq;       /* claim index + 1 once the record is complete */
+    uint32_t ts;        /* cpu_cycles() */
+    uint8_t code;
+    uint8_t irq;
+    uint16_t pad;
+    uint32_t arg;
+};
+
+#define EVLOG_SIZE  256u        /* records, power of two */
+#define EVLOG_MASK  (EVLOG_SIZE - 1)
+
+extern struct ev_rec evlog_ring[EVLOG_SIZE];
+extern volatile uint32_t evlog_claim;
+extern volatile uint32_t evlog_tail;
+extern volatile uint32_t evlog_lost;
+
+static inline void evlog(uint8_t code, uint8_t irq, uint32_t arg)
+{
+    uint32_t c = __atomic_load_n(&evlog_claim, __ATOMIC_RELAXED);
+    struct ev_rec *r;
+
+    do {
+        if (c - __atomic_load_n(&evlog_tail, __ATOMIC_ACQUIRE) >= EVLOG_SIZE) {
+            evlog_lost++;
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&evlog_claim, &c, c + 1, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    r = &evlog_ring[c & EVLOG_MASK];
+    r->ts = cpu_cycles();
+    r->code = code;
+    r->irq = irq;
+    r->arg = arg;
+    __atomic_store_n(&r->seq, c + 1, __ATOMIC_RELEASE);
+}
+
+static inline int evlog_empty(void)
+{
+    return __atomic_load_n(&evlog_claim, __ATOMIC_ACQUIRE) == evlog_tail;
+}
+
+/* print logged events, main loop only; returns how many */
+uint32_t evlog_drain(void);
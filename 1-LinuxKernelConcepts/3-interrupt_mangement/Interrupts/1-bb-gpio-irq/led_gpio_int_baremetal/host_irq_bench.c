@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * The whole firmware on the host, main() included, against the peripheral
+ * model of ../../am335x-sim (make host-sim). Nothing is stubbed out: init,
+ * the AINTC setup, irq_dispatch() and the ISRs are the ARM build's sources.
+ *
+ * The driver plays the board:
+ *   - the button (GPIO1_15) is pressed and released every 50 ms, which is
+ *     what the TEST1 wait at boot is looking for
+ *   - once the firmware has settled, a burst of GPIO1_15 edges every 5 us:
+ *     each one is an IRQ exception, irq_dispatch and gpio1_isr posting the
+ *     button task; the main loop runs it, the LED (GPIO1_12) follows the
+ *     pin and it writes an event log record
+ *   - GPTimer2 overflows and UART0 TX IRQs keep coming from the models
+ *
+ * Times in the firmware's output are simulated AM335x time; events/s at
+ * the end are host wall-clock, the figure to watch in CI.
+ *
+ *   ./host_irq_bench [edges] [-v]      -v: show the firmware's UART output
+ */
+
+/* glibc's entry point is called _start too */
+#define _start boot_vectors
+#define main firmware_main
+#include "main.c"
+#undef main
+
+/* startup.S stand-ins: both vector tables lead to the same entry here */
+uint32_t boot_vectors[8];
+uint32_t __fast_vectors[8];
+volatile uint32_t irq_entry_cycles;
+
+#define BUTTON_BANK         1
+#define BUTTON_PIN          15
+#define BUTTON_EVERY_NS     (50ull * 1000 * 1000)
+#define BURST_AT_NS         (3000ull * 1000 * 1000)
+#define EDGE_EVERY_NS       5000ull
+#define DRAIN_NS            (50ull * 1000 * 1000)
+#define DEFAULT_EDGES       200000u
+#define UART_CHARS_PER_S    (115200 / 10)   /* 8N1 */
+
+static int verbose;
+static int pin_level = 1;
+static int burst_on;
+static uint32_t edges_left, edges_total;
+static uint32_t gpio_irqs_before;
+static uint32_t button_before;
+static uint64_t sim_t0, sim_t1;
+static struct timespec wall_t0, wall_t1;
+static int saw_unknown;
+static uint32_t burst_chars, burst_events;  /* console output while the edges come */
+
+/* the firmware's console */
+static void console(char c)
+{
+    static char line[256];
+    static size_t n;
+
+    if (verbose)
+        putchar(c);
+    if (edges_left)
+        burst_chars++;
+    if (c == '\n' || n == sizeof(line) - 1) {
+        line[n] = 0;
+        if (strstr(line, "source: UNKNOWN"))
+            saw_unknown = 1;
+        if (edges_left && strstr(line, "[GPIO] Button"))
+            burst_events++;
+        n = 0;
+    } else if (c != '\r') {
+        line[n++] = c;
+    }
+}
+
+static void host_irq_entry(void)
+{
+    irq_entry_cycles = cpu_cycles();
+    irq_dispatch();
+}
+
+static void set_button(int level)
+{
+    pin_level = level;
+    sim_gpio_set(BUTTON_BANK, BUTTON_PIN, level);
+}
+
+static void button(void *ctx)
+{
+    (void)ctx;
+    if (burst_on)
+        return;
+    set_button(!pin_level);
+    sim_at(sim_now_ns() + BUTTON_EVERY_NS, button, 0);
+}
+
+static void stop(void *ctx)
+{
+    (void)ctx;
+    sim_stop();
+}
+
+static void edge(void *ctx)
+{
+    (void)ctx;
+    if (!edges_left) {
+        clock_gettime(CLOCK_MONOTONIC, &wall_t1);
+        sim_t1 = sim_now_ns();
+        sim_at(sim_now_ns() + DRAIN_NS, stop, 0);
+        return;
+    }
+    set_button(!pin_level);
+    edges_left--;
+    sim_at(sim_now_ns() + EDGE_EVERY_NS, edge, 0);
+}
+
+static void burst(void *ctx)
+{
+    struct irq_stat st;
+
+    (void)ctx;
+    burst_on = 1;
+    irq_get_stat(GPIO1_IRQ, &st);
+    gpio_irqs_before = st.count;
+    button_before = task_button.runs + task_button.dropped;
+    edges_left = edges_total;
+    sim_t0 = sim_now_ns();
+    clock_gettime(CLOCK_MONOTONIC, &wall_t0);
+    sim_at(sim_now_ns() + EDGE_EVERY_NS, edge, 0);
+}
+
+static void print_task(const struct task *t)
+{
+    printf("  %-9s task:    %9u runs, max %5u / budget %6u cycles, %u overruns, %u dropped\n",
+           t->name, t->runs, t->max_cycles, t->budget_cycles, t->overruns, t->dropped);
+}
+
+static void print_stat(const char *name, uint32_t irq)
+{
+    struct irq_stat st;
+
+    irq_get_stat(irq, &st);
+    printf("  %-9s irq %3u: %9u calls, handler %5u..%5u cycles\n",
+           name, irq, st.count, st.min_cycles, st.max_cycles);
+}
+
+int main(int argc, char **argv)
+{
+    struct irq_stat st;
+    uint32_t unexpected = 0;
+    double wall_s, sim_s;
+    int led, ok;
+
+    edges_total = DEFAULT_EDGES;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v"))
+            verbose = 1;
+        else
+            edges_total = (uint32_t)strtoul(argv[i], NULL, 0);
+    }
+
+    sim_uart_set_tx_hook(console);
+    sim_set_irq_vector(host_irq_entry);
+    set_button(1);
+    sim_at(BUTTON_EVERY_NS, button, 0);
+    sim_at(BURST_AT_NS, burst, 0);
+
+    sim_run(firmware_main);
+
+    wall_s = (double)(wall_t1.tv_sec - wall_t0.tv_sec) + (wall_t1.tv_nsec - wall_t0.tv_nsec) * 1e-9;
+    sim_s = (double)(sim_t1 - sim_t0) * 1e-9;
+    irq_get_stat(GPIO1_IRQ, &st);
+    led = (sim_gpio_out(BUTTON_BANK) & GPIO1_12) != 0;
+
+    for (uint32_t irq = 0; irq < NR_IRQS; irq++) {
+        struct irq_stat s;
+
+        irq_get_stat(irq, &s);
+        if (s.count && irq != GPIO1_IRQ && irq != GPTIMER2_IRQ && irq != UART0_IRQ &&
+            irq != SWIRQ_IRQ)
+            unexpected += s.count;
+    }
+
+    printf("burst    %u GPIO1_15 edges in %.3f s simulated, %.3f s host: %.2f M events/s\n",
+           edges_total, sim_s, wall_s, wall_s > 0 ? edges_total / wall_s / 1e6 : 0.0);
+    printf("         %llu IRQ exceptions, %llu register accesses in total\n",
+           (unsigned long long)sim_stats.irqs,
+           (unsigned long long)(sim_stats.reads + sim_stats.writes));
+    print_stat("GPIO1", GPIO1_IRQ);
+    print_stat("GPTIMER2", GPTIMER2_IRQ);
+    print_stat("UART0", UART0_IRQ);
+    print_task(&task_button);
+    print_task(&task_tick);
+    print_task(&task_stats);
+    printf("  console in the burst: %u chars (%.0f/s), %u button events logged\n",
+           burst_chars, sim_s > 0 ? burst_chars / sim_s : 0.0, burst_events);
+    printf("  GPIO1 IRQs in the burst %u, LED %s, button %s, ticks %u\n",
+           st.count - gpio_irqs_before, led ? "on" : "off", pin_level ? "released" : "pressed",
+           timer_ticks);
+
+    /* every edge posted, none lost without being counted, no task over budget */
+    ok = st.count - gpio_irqs_before == edges_total &&
+         task_button.runs + task_button.dropped - button_before == edges_total &&
+         !task_button.overruns && !task_tick.overruns && !task_stats.overruns &&
+         (timer_ticks < STATS_EVERY_TICKS || task_stats.runs > 0) &&
+         /* tasks don't starve the main loop: the log keeps the UART busy */
+         burst_events > 0 && burst_chars >= sim_s * UART_CHARS_PER_S * 0.9 &&
+         led == pin_level &&
+         timer_ticks > 0 &&
+         !unexpected && !saw_unknown &&
+         !sim_wdt_running() &&
+         !sim_uart_overruns();
+    printf("%s\n", ok ? "OK" : "FAIL");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+#include <stdint.h>
+#include "irq.h"
+#include "cpu.h"
+#include "evlog.h"
+#include "uart.h"
+#include "prof.h"
+
+#ifndef REG32
+#define REG32(a) (*(volatile uint32_t *)(a))
+#endif
+
+#define AINTC_BASE          0x48200000
+#define INTC_SIR_IRQ        (AINTC_BASE + 0x40)
+#define INTC_CONTROL        (AINTC_BASE + 0x48)
+#define INTC_MIR_CLEAR(n)   (AINTC_BASE + 0x88 + 0x20 * (n))
+#define INTC_MIR_SET(n)     (AINTC_BASE + 0x8C + 0x20 * (n))
+
+/* IRQs handled per exception entry before main gets to run again */
+#define IRQ_DRAIN_MAX       16
+
+/*
+ * One slot per AINTC line: dispatch is SIR_IRQ -> index, whatever the
+ * number of registered handlers. Unregistered lines go to irq_unhandled(),
+ * which masks them so a stuck one can't keep the CPU in IRQ mode.
+ */
+struct irq_slot {
+    irq_handler_t fn;
+    void *ctx;
+    struct irq_stat st;
+};
+
+static struct irq_slot irq_table[NR_IRQS] __fast_bss;
+
+static void irq_unhandled(void *ctx)
+{
+    uint32_t irq = (uint32_t)(uintptr_t)ctx;
+
+    irq_mask(irq);
+    evlog(EV_IRQ_UNKNOWN, (uint8_t)irq, 0);
+}
+
+int register_irq_handler(uint32_t irq, irq_handler_t fn, void *ctx)
+{
+    if (irq >= NR_IRQS || !fn)
+        return -1;
+    irq_table[irq].ctx = ctx;
+    irq_table[irq].fn = fn;
+    return 0;
+}
+
+void irq_unmask(uint32_t irq)
+{
+    REG32(INTC_MIR_CLEAR(irq >> 5)) = 1u << (irq & 31);
+}
+
+void irq_mask(uint32_t irq)
+{
+    REG32(INTC_MIR_SET(irq >> 5)) = 1u << (irq & 31);
+}
+
+__fast void irq_dispatch(void)
+{
+    PROF_BEGIN(PROF_IRQ_DISPATCH);
+
+    for (int n = 0; n < IRQ_DRAIN_MAX; n++) {
+        uint32_t sir = REG32(INTC_SIR_IRQ);
+        uint32_t irq = sir & SIR_ACTIVE_MASK;
+        struct irq_slot *s = &irq_table[irq];
+        uint32_t t0, dt;
+
+        if ((sir & SIR_SPURIOUS_MASK) == SIR_SPURIOUS_MASK)
+            break;
+
+        t0 = cpu_cycles();
+        if (s->fn)
+            s->fn(s->ctx);
+        else
+            irq_unhandled((void *)(uintptr_t)irq);
+        dt = cpu_cycles() - t0;
+
+        s->st.count++;
+        if (dt < s->st.min_cycles || s->st.count == 1)
+            s->st.min_cycles = dt;
+        if (dt > s->st.max_cycles)
+            s->st.max_cycles = dt;
+
+        /* NEWIRQAGR, then SIR shows the next one up, if any */
+        REG32(INTC_CONTROL) = 1;
+        cpu_dsb();
+    }
+
+    PROF_END(PROF_IRQ_DISPATCH);
+}
+
+void irq_get_stat(uint32_t irq, struct irq_stat *st)
+{
+    if (irq < NR_IRQS)
+        *st = irq_table[irq].st;
+}
+
+void irq_print_stats(void)
+{
+    for (uint32_t irq = 0; irq < NR_IRQS; irq++) {
+        struct irq_stat st = irq_table[irq].st;
+
+        if (!st.count)
+            continue;
+        uart_puts("[IRQ] ");
+        print_dec_u32(irq);
+        uart_puts(": count ");
+        print_dec_u32(st.count);
+        uart_puts(" min ");
+        print_dec_u32(st.min_cycles);
+        uart_puts(" max ");
+        print_dec_u32(st.max_cycles);
+        uart_puts(" cycles\n");
+    }
+}
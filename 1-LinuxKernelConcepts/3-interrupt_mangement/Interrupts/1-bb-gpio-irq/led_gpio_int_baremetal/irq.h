@@ -0,0 +1,32 @@
+#pragma once
+#include <stdint.h>
+
+#define NR_IRQS 128
+
+/* INTC_SIR_IRQ fields */
+#define SIR_ACTIVE_MASK     0x7Fu
+#define SIR_SPURIOUS_MASK   0xFFFFFF80u     /* all ones: nothing pending */
+
+typedef void (*irq_handler_t)(void *ctx);
+
+struct irq_stat {
+    uint32_t count;
+    uint32_t min_cycles;        /* handler only, dispatch overhead excluded */
+    uint32_t max_cycles;
+};
+
+/* 0, or -1 for a bad irq number; replaces any previous handler */
+int register_irq_handler(uint32_t irq, irq_handler_t fn, void *ctx);
+void irq_unmask(uint32_t irq);
+void irq_mask(uint32_t irq);
+
+/* IRQ exception entry (startup.S): runs every pending IRQ, then returns */
+void irq_dispatch(void);
+
+/* startup.S: boot (DDR) and SRAM vector tables, CCNT at the last IRQ entry */
+extern uint32_t _start[];
+extern uint32_t __fast_vectors[];
+extern volatile uint32_t irq_entry_cycles;
+
+void irq_get_stat(uint32_t irq, struct irq_stat *st);
+void irq_print_stats(void);
@@ -1,11 +1,23 @@
 #include <stdint.h>
 #include "uart.h"
+#include "cpu.h"
+#include "evlog.h"
+#include "irq.h"
+#include "prof.h"
+#include "sched.h"
 
+#ifndef REG32
 #define REG32(a) (*(volatile uint32_t *)(a))
+#endif
 
 /* ========================= Teaching knobs ========================= */
 #define TEACHING_POLL_ASSIST   0   /* 1 = allow polling assist path (NOT real IRQ), 0 = pure interrupt demo */
 #define TEACHING_VERBOSE_DUMPS  1   /* 1 = dump registers after init */
+#define STATS_EVERY_TICKS    1000   /* per-IRQ count/cycles table, in timer ticks */
+#define TICK_LOG_EVERY        366   /* EV_TICK every ~1 s (2.73 ms ticks), not ~366 lines/s */
+#define BUTTON_BUDGET_US       20   /* task CPU budgets, over them is an overrun */
+#define TICK_BUDGET_US        100
+#define STATS_BUDGET_US      1000
 
 /* -------- Base addresses -------- */
 #define CM_PER_BASE        0x44E00000
@@ -50,16 +62,14 @@
 #define INTC_SYSCONFIG     (AINTC_BASE + 0x10)
 #define INTC_SIR_IRQ       (AINTC_BASE + 0x40)
 #define INTC_CONTROL       (AINTC_BASE + 0x48)
-#define INTC_MIR2          (AINTC_BASE + 0xA4)  /* IRQ 64-95 */
-#define INTC_MIR_CLEAR2    (AINTC_BASE + 0xA8)
-#define INTC_MIR_SET2      (AINTC_BASE + 0xAC)
-#define INTC_MIR3          (AINTC_BASE + 0xC4)  /* IRQ 96-127 */
-#define INTC_MIR_CLEAR3    (AINTC_BASE + 0xC8)
-#define INTC_MIR_SET3      (AINTC_BASE + 0xCC)
+#define INTC_MIR2          (AINTC_BASE + 0xC4)  /* IRQ 64-95, banks are 0x20 apart from MIR0 at 0x84 */
+#define INTC_MIR3          (AINTC_BASE + 0xE4)  /* IRQ 96-127 */
 #define INTC_PROTECTION    (AINTC_BASE + 0x4C)
 #define INTC_IDLE          (AINTC_BASE + 0x50)
 #define INTC_PENDING_IRQ2   (AINTC_BASE + 0xD8)  /* IRQ 64-95 pending */
 #define INTC_PENDING_IRQ3   (AINTC_BASE + 0xF8)  /* IRQ 96-127 pending */
+#define INTC_ISR_SET3       (AINTC_BASE + 0xF0)  /* IRQ 96-127 software set */
+#define INTC_ISR_CLEAR3     (AINTC_BASE + 0xF4)
 
 #define CM_PER_L4LS_CLKSTCTRL (CM_PER_BASE + 0x00)   /* L4LS clock state control */
 
@@ -74,37 +84,20 @@
 /* IRQ numbers */
 #define GPIO1_IRQ      99
 #define GPTIMER2_IRQ   68
+#define SWIRQ_IRQ      98   /* GPIO1 line A, unused: raised by software for the entry benchmark */
+
+#define ENTRY_BENCH_SAMPLES 64
+#define PROOF_POLL_SPINS    1000000   /* SIR_IRQ reads before a PROOF poll gives up */
 
 /* Watchdog */
 #define WDT_BASE   0x44E35000
-#define WDT_WSPR   (*(volatile unsigned int *)(WDT_BASE + 0x48))
-#define WDT_WWPS   (*(volatile unsigned int *)(WDT_BASE + 0x34))
+#define WDT_WSPR   (WDT_BASE + 0x48)
+#define WDT_WWPS   (WDT_BASE + 0x34)
 
 static volatile int led_state = 0;
 volatile uint32_t timer_ticks = 0;
 
 /* ========================= Debug helpers ========================= */
-static void print_hex(uint32_t val)
-{
-    static const char hex_chars[] = "0123456789ABCDEF";
-    uart_puts("0x");
-    for (int i = 28; i >= 0; i -= 4)
-        uart_putc(hex_chars[(val >> i) & 0xF]);
-}
-
-static void print_dec_u32(uint32_t v)
-{
-    /* simple decimal printing without stdlib */
-    char buf[11];
-    int i = 0;
-    if (v == 0) { uart_putc('0'); return; }
-    while (v > 0 && i < 10) {
-        buf[i++] = (char)('0' + (v % 10));
-        v /= 10;
-    }
-    while (i--) uart_putc(buf[i]);
-}
-
 static void dump_gpio_registers(void)
 {
     uart_puts("[DUMP] === GPIO1 Registers ===\n");
@@ -135,9 +128,8 @@ static void dump_aintc_registers(void)
 
 static void debug_interrupt_setup(void)
 {
-    uint32_t cpsr, vbar;
-    asm volatile ("mrs %0, cpsr" : "=r"(cpsr));
-    asm volatile ("mrc p15, 0, %0, c12, c0, 0" : "=r"(vbar));
+    uint32_t cpsr = cpu_get_cpsr();
+    const uint32_t *vectors = cpu_get_vbar();
 
     uart_puts("[DEBUG] === Interrupt Setup Check ===\n");
     uart_puts("[DEBUG] CPSR="); print_hex(cpsr);
@@ -145,10 +137,9 @@ static void debug_interrupt_setup(void)
     uart_puts(" IRQ="); uart_puts((cpsr & 0x80) ? "MASKED" : "ENABLED");
     uart_putc('\n');
 
-    uart_puts("[DEBUG] VBAR="); print_hex(vbar); uart_putc('\n');
+    uart_puts("[DEBUG] VBAR="); print_hex((uint32_t)(uintptr_t)vectors); uart_putc('\n');
 
     /* Check vector table content */
-    uint32_t *vectors = (uint32_t *)vbar;
     uart_puts("[DEBUG] Vector[0]="); print_hex(vectors[0]); uart_putc('\n');
     uart_puts("[DEBUG] Vector[6]="); print_hex(vectors[6]); uart_puts(" (IRQ)\n");
 
@@ -159,75 +150,102 @@ static void debug_interrupt_setup(void)
     uart_puts("[DEBUG] ==============================\n");
 }
 
-/* ========================= ISRs ========================= */
-void gpio1_isr(void)
+/* ========================= Tasks ========================= */
+/* run by sched_run() from the main loop, posted by the ISRs below */
+static void stats_task(uint32_t arg)
 {
-    uart_puts("[GPIO] ISR entered\n");
-
-    /* Clear pending for button (W1C) */
-    REG32(GPIO_IRQSTATUS_0) = GPIO1_15;
-    REG32(GPIO_IRQSTATUS_1) = GPIO1_15;
+    (void)arg;
+    irq_print_stats();
+    sched_print_stats();
+}
 
-    /* Read current button state to determine press/release */
-    uint32_t button_state = REG32(GPIO_DATAIN) & GPIO1_15;
+static struct task task_stats =
+    TASK_INIT("stats", stats_task, SCHED_PRIO_LOW, STATS_BUDGET_US * CPU_MHZ);
 
-    if (button_state == 0) {
+static void button_task(uint32_t pressed)
+{
+    if (pressed) {
         /* Button is LOW (pressed) - turn LED OFF */
         REG32(GPIO_CLEARDATAOUT) = GPIO1_12;
         led_state = 0;
-        uart_puts("[GPIO] Button PRESSED - LED OFF\n");
     } else {
         /* Button is HIGH (released) - turn LED ON */
         REG32(GPIO_SETDATAOUT) = GPIO1_12;
         led_state = 1;
-        uart_puts("[GPIO] Button RELEASED - LED ON\n");
     }
+    evlog(EV_BUTTON, GPIO1_IRQ, pressed);
+}
+
+static void tick_task(uint32_t tick)
+{
+    if (tick % TICK_LOG_EVERY == 0)
+        evlog(EV_TICK, GPTIMER2_IRQ, tick);
+
+    /* the tables are long: after anything more urgent */
+    if (tick % STATS_EVERY_TICKS == 0)
+        sched_post(&task_stats, 0);
+}
+
+static struct task task_button =
+    TASK_INIT("button", button_task, SCHED_PRIO_HIGH, BUTTON_BUDGET_US * CPU_MHZ);
+static struct task task_tick =
+    TASK_INIT("tick", tick_task, SCHED_PRIO_NORMAL, TICK_BUDGET_US * CPU_MHZ);
+
+/* ========================= ISRs ========================= */
+/* acknowledge and post: the work is a task, what happened goes to the event log */
+static __fast void gpio1_isr(void *ctx)
+{
+    (void)ctx;
+    PROF_BEGIN(PROF_GPIO1_ISR);
+
+    /* Clear pending for button (W1C) */
+    REG32(GPIO_IRQSTATUS_0) = GPIO1_15;
+    REG32(GPIO_IRQSTATUS_1) = GPIO1_15;
+
+    /* Button state now, the task may run after the next edge: LOW is pressed */
+    sched_post(&task_button, (REG32(GPIO_DATAIN) & GPIO1_15) == 0);
+    PROF_END(PROF_GPIO1_ISR);
 }
 
-void gptimer2_isr(void)
+static __fast void gptimer2_isr(void *ctx)
 {
+    (void)ctx;
+    PROF_BEGIN(PROF_GPTIMER2_ISR);
     REG32(TISR) = 0x2;  /* clear overflow */
     timer_ticks++;
-    uart_puts("[TIMER] tick #");
-    print_dec_u32(timer_ticks);
-    uart_putc('\n');
+    sched_watchdog();
+    sched_post(&task_tick, timer_ticks);
+    PROF_END(PROF_GPTIMER2_ISR);
 }
 
-/* ========================= IRQ Dispatch ========================= */
-void irq_dispatch(void)
+/* TX refill; it doesn't log: printing that would mean more TX, and so on */
+static __fast void uart0_isr(void *ctx)
 {
-    REG32(INTC_CONTROL) = 1;
-    uint32_t irq = REG32(INTC_SIR_IRQ) & 0x7F;
-
-    uart_puts("[IRQ] received: ");
-    print_dec_u32(irq);
-    uart_putc('\n');
+    (void)ctx;
+    PROF_BEGIN(PROF_UART0_ISR);
+    uart_isr();
+    PROF_END(PROF_UART0_ISR);
+}
 
-    if (irq == GPIO1_IRQ) {
-        uart_puts("[IRQ] source: GPIO1\n");
-        gpio1_isr();
-    }
-    else if (irq == GPTIMER2_IRQ) {
-        uart_puts("[IRQ] source: GPTIMER2\n");
-        gptimer2_isr();
-    }
-    else {
-        uart_puts("[IRQ] source: UNKNOWN irq=");
-        print_dec_u32(irq);
-        uart_putc('\n');
-    }
+/* entry latency benchmark: software IRQ, timestamps of its entry and handler */
+static volatile uint32_t swirq_entry;
+static volatile uint32_t swirq_handler;
 
-    /* Acknowledge (new IRQ agreement) */
-    REG32(INTC_CONTROL) = 1;
+static __fast void swirq_isr(void *ctx)
+{
+    (void)ctx;
+    swirq_handler = cpu_cycles();
+    swirq_entry = irq_entry_cycles;
+    REG32(INTC_ISR_CLEAR3) = 1u << (SWIRQ_IRQ - 96);
 }
 
 /* ========================= Init ========================= */
 static void wdt_disable(void)
 {
-    WDT_WSPR = 0xAAAA;
-    while (WDT_WWPS & (1 << 4));
-    WDT_WSPR = 0x5555;
-    while (WDT_WWPS & (1 << 4));
+    REG32(WDT_WSPR) = 0xAAAA;
+    while (REG32(WDT_WWPS) & (1 << 4));
+    REG32(WDT_WSPR) = 0x5555;
+    while (REG32(WDT_WWPS) & (1 << 4));
 }
 
 static void gpio1_clock_enable(void)
@@ -388,12 +406,21 @@ static void aintc_setup(void)
     REG32(INTC_ILR(98)) = 0x0;  /* GPIO1A -> IRQ */
     REG32(INTC_ILR(99)) = 0x0;  /* GPIO1B -> IRQ */
     REG32(INTC_ILR(68)) = 0x0;  /* GPTimer2 -> IRQ */
-    uart_puts("[AINTC] ILR routing set: GPIO1A/GPIO1B/TIMER2 -> IRQ\n");
+    REG32(INTC_ILR(UART0_IRQ)) = 0x0;  /* UART0 -> IRQ */
+    uart_puts("[AINTC] ILR routing set: GPIO1A/GPIO1B/TIMER2/UART0 -> IRQ\n");
+
+    /* Tasks the handlers post */
+    sched_add(&task_button);
+    sched_add(&task_tick);
+    sched_add(&task_stats);
+
+    /* Handlers: irq_dispatch() (irq.c) looks them up by SIR_IRQ */
+    register_irq_handler(GPIO1_IRQ, gpio1_isr, 0);
+    register_irq_handler(GPTIMER2_IRQ, gptimer2_isr, 0);
+    register_irq_handler(UART0_IRQ, uart0_isr, 0);
 
-    /* Unmask GPIO1 IRQ=99 -> MIR3 bit(99-96)=3 */
+    /* GPIO1 IRQ=99 -> MIR3 bit(99-96)=3 */
     uint32_t gpio_bit = (GPIO1_IRQ - 96);
-    /* Unmask Timer2 IRQ=68 -> MIR2 bit(68-64)=4 */
-    uint32_t tim_bit = (GPTIMER2_IRQ - 64);
 
     /* CRITICAL FIX: After reset, ALL interrupts are masked (0xFFFFFFFF)
      * We need to unmask specific interrupts */
@@ -401,68 +428,137 @@ static void aintc_setup(void)
     uart_puts("[AINTC] CRITICAL: MIR3 should be 0xFFFFFFFF (all masked)\n");
 
     /* Clear specific interrupt masks */
-    REG32(INTC_MIR_CLEAR3) = (1u << gpio_bit);  /* Unmask GPIO1 IRQ99 */
-    REG32(INTC_MIR_CLEAR2) = (1u << tim_bit);   /* Unmask Timer2 IRQ68 */
+    irq_unmask(GPIO1_IRQ);
+    irq_unmask(GPTIMER2_IRQ);
+    irq_unmask(UART0_IRQ);
 
     uart_puts("[AINTC] After unmask - MIR3="); print_hex(REG32(INTC_MIR3)); uart_putc('\n');
     uart_puts("[AINTC] CRITICAL: MIR3 should now have bit "); print_dec_u32(gpio_bit); uart_puts(" cleared\n");
     dump_aintc_registers();
 }
 
-static void set_vector_base(void)
+static void set_vector_base(const uint32_t *vectors)
 {
-    extern uint32_t _start;
-    uint32_t vector_addr = (uint32_t)&_start;
-
     uart_puts("[VBAR] Setting VBAR=");
-    print_hex(vector_addr);
+    print_hex((uint32_t)(uintptr_t)vectors);
     uart_putc('\n');
 
-    asm volatile ("mcr p15, 0, %0, c12, c0, 0" : : "r"(vector_addr));
-
-    uint32_t vbar_read;
-    asm volatile ("mrc p15, 0, %0, c12, c0, 0" : "=r"(vbar_read));
+    cpu_set_vbar(vectors);
 
     uart_puts("[VBAR] Readback VBAR=");
-    print_hex(vbar_read);
+    print_hex((uint32_t)(uintptr_t)cpu_get_vbar());
     uart_putc('\n');
 }
 
+/*
+ * Poll SIR_IRQ for an active line. Only an unmasked pending IRQ shows up
+ * there, so with the line masked (before aintc_setup) or already taken by
+ * the CPU this may see nothing: bounded, not a hang.
+ */
+static void proof_poll_sir(void)
+{
+    for (uint32_t i = 0; i < PROOF_POLL_SPINS; i++) {
+        uint32_t sir = REG32(INTC_SIR_IRQ);
+        if ((sir & SIR_SPURIOUS_MASK) != SIR_SPURIOUS_MASK) {
+            uart_puts("[PROOF] SIR_IRQ=");
+            print_hex(sir);
+            uart_puts(" irq=");
+            print_dec_u32(sir & SIR_ACTIVE_MASK);
+            uart_putc('\n');
+            return;
+        }
+    }
+    uart_puts("[PROOF] SIR_IRQ: nothing pending (masked or already taken)\n");
+}
+
 static inline void setup_arm_irq_mode(void)
 {
     uint32_t cpsr_before, cpsr_after;
 
     uart_puts("[ARM] Before mode change...\n");
-    asm volatile ("mrs %0, cpsr" : "=r"(cpsr_before));
+    cpsr_before = cpu_get_cpsr();
     uart_puts("[ARM] Current CPSR="); print_hex(cpsr_before); uart_putc('\n');
 
     /* Just enable IRQs first, don't change mode yet */
-    asm volatile (
-        "mrs r0, cpsr\n"
-        "bic r0, r0, #0x80\n"     /* Clear IRQ disable bit only */
-        "msr cpsr_c, r0\n"
-        : : : "r0"
-    );
-
-    asm volatile ("mrs %0, cpsr" : "=r"(cpsr_after));
+    cpu_irq_enable();
+
+    cpsr_after = cpu_get_cpsr();
     uart_puts("[ARM] After IRQ enable - CPSR="); print_hex(cpsr_after); uart_putc('\n');
     uart_puts("[ARM] IRQ enable complete\n");
 }
+/*
+ * IRQ entry latency from DDR vs SRAM (OCMC): the same software IRQ through
+ * the boot vectors / irq_handler_ddr, then through __fast_vectors /
+ * irq_handler. "entry" is ISR_SET write to the first instructions of the
+ * IRQ entry, "handler" to swirq_isr running (dispatch included, in SRAM in
+ * both cases). Leaves VBAR on the SRAM vectors.
+ */
+static void entry_latency_run(const char *name, const uint32_t *vbar)
+{
+    uint32_t entry_min = 0xFFFFFFFFu, entry_max = 0;
+    uint32_t handler_min = 0xFFFFFFFFu, handler_max = 0;
+
+    set_vector_base(vbar);
+
+    for (int i = 0; i < ENTRY_BENCH_SAMPLES; i++) {
+        uint32_t t0, entry, handler;
+
+        swirq_handler = 0;
+        t0 = cpu_cycles();
+        REG32(INTC_ISR_SET3) = 1u << (SWIRQ_IRQ - 96);
+        while (swirq_handler == 0)
+            ;
+        entry = swirq_entry - t0;
+        handler = swirq_handler - t0;
+
+        if (entry < entry_min) entry_min = entry;
+        if (entry > entry_max) entry_max = entry;
+        if (handler < handler_min) handler_min = handler;
+        if (handler > handler_max) handler_max = handler;
+    }
+
+    uart_puts("[BENCH] ");
+    uart_puts(name);
+    uart_puts(" vectors: entry min "); print_dec_u32(entry_min);
+    uart_puts(" max "); print_dec_u32(entry_max);
+    uart_puts(", handler min "); print_dec_u32(handler_min);
+    uart_puts(" max "); print_dec_u32(handler_max);
+    uart_puts(" cycles\n");
+}
+
+static void entry_latency_bench(void)
+{
+    register_irq_handler(SWIRQ_IRQ, swirq_isr, 0);
+    irq_unmask(SWIRQ_IRQ);
+
+    entry_latency_run("DDR", _start);
+    entry_latency_run("SRAM", __fast_vectors);
+
+    irq_mask(SWIRQ_IRQ);
+}
+
 /* ========================= main ========================= */
 int main(void)
 {
     wdt_disable();
+    cpu_cycles_init();
+    prof_init();
+
+    PROF_BEGIN(PROF_INIT_UART);
     uart_init();
+    PROF_END(PROF_INIT_UART);
     uart_puts("[BOOT] main entered\n");
 
-    set_vector_base();
+    set_vector_base(_start);
     uart_puts("[BOOT] vector base set\n");
 
     gpio1_clock_enable();
     cm_l4ls_wakeup();
     uart_puts("[BOOT] GPIO1 clock enabled\n");
 
+    PROF_BEGIN(PROF_INIT_GPIO1_MODULE);
     gpio1_module_init();
+    PROF_END(PROF_INIT_GPIO1_MODULE);
     uart_puts("[GPIO] After module init: OE=");
     print_hex(REG32(GPIO_OE));
     uart_puts(" DATAIN=");
@@ -473,19 +569,25 @@ int main(void)
     gptimer2_clock_enable();
     uart_puts("[BOOT] GPTimer2 clock enabled\n");
 
+    PROF_BEGIN(PROF_INIT_PINMUX);
     pinmux_setup();
+    PROF_END(PROF_INIT_PINMUX);
     uart_puts("[BOOT] pinmux configured\n");
     uart_puts("[PINMUX] CONF_P8_12="); print_hex(REG32(CONF_P8_12)); uart_putc('\n');
     uart_puts("[PINMUX] CONF_P8_15="); print_hex(REG32(CONF_P8_15)); uart_putc('\n');
 
+    PROF_BEGIN(PROF_INIT_GPIO);
     gpio_setup();
+    PROF_END(PROF_INIT_GPIO);
     uart_puts("[BOOT] GPIO configured\n");
     uart_puts("[TEST] DATAIN=");
     print_hex(REG32(GPIO_DATAIN));
     uart_puts(" GPIO1_15=");
     uart_puts((REG32(GPIO_DATAIN) & GPIO1_15) ? "1 (HIGH)\n" : "0 (LOW)\n");
 
+    PROF_BEGIN(PROF_INIT_TIMER);
     gptimer2_init();
+    PROF_END(PROF_INIT_TIMER);
 
     uart_puts("[MANUAL TEST] Press and hold button, then type something...\n");
     for (int i = 0; i < 5; i++) {
@@ -527,15 +629,7 @@ int main(void)
     }
 
     uart_puts("[PROOF] Now polling AINTC while GPIO status is still set...\n");
-    for (uint32_t i=0; i<5000000; i++) {
-        uint32_t sir = REG32(INTC_SIR_IRQ);
-        if ((sir & 0x7F) != 0x80) {
-            uart_puts("[PROOF] SIR_IRQ=");
-            print_hex(sir);
-            uart_putc('\n');
-            break;
-        }
-    }
+    proof_poll_sir();
 
     /* NOW clear it */
     REG32(GPIO_IRQSTATUS_0) = GPIO1_15;
@@ -543,17 +637,11 @@ int main(void)
     uart_puts("[TEST1] Cleared GPIO IRQSTATUS\n");
 
     uart_puts("[PROOF] Press button now; polling SIR_IRQ...\n");
-    while (1) {
-        uint32_t sir = REG32(INTC_SIR_IRQ);
-        if ((sir & 0x7F) != 0x80) {  /* not spurious */
-            uart_puts("[PROOF] SIR_IRQ=");
-            print_hex(sir);
-            uart_putc('\n');
-            break;
-        }
-    }
+    proof_poll_sir();
 
+    PROF_BEGIN(PROF_INIT_AINTC);
     aintc_setup();
+    PROF_END(PROF_INIT_AINTC);
     uart_puts("[BOOT] AINTC configured\n");
 
     debug_interrupt_setup();
@@ -562,6 +650,9 @@ int main(void)
     uart_puts("[BOOT] IRQ enabled and ARM mode set\n");
     debug_interrupt_setup();
 
+    entry_latency_bench();
+    uart_puts("[BOOT] vector base now in SRAM\n");
+
     uart_puts("[INFO] Press P8.15 button => LED OFF, Release => LED ON\n");
 
     uart_puts("[TIMER TEST] Waiting for TISR overflow...\n");
@@ -575,20 +666,32 @@ int main(void)
 
     /* Now do PROOF polling */
     uart_puts("[PROOF] Press button now; polling SIR_IRQ...\n");
-    while (1) {
-        uint32_t sir = REG32(INTC_SIR_IRQ);
-        if ((sir & 0x7F) != 0x80) {
-            uart_puts("[PROOF] SIR_IRQ=");
-            print_hex(sir);
-            uart_putc('\n');
-            break;
-        }
-    }
+    proof_poll_sir();
+
+    /* from here on uart_puts only queues, from ISRs too */
+    uart_tx_irq_enable();
+    uart_puts("[BOOT] UART TX interrupt-driven\n");
 
     uint32_t loop_count = 0;
     while (1) {
         loop_count++;
 
+        /* one task per pass, then the console and the log: a burst of events doesn't hold them off */
+        int ran = sched_run();
+
+        /* console: 'p' profile table, 'r' reset it (polled, seen on the next wakeup) */
+        switch (uart_getc()) {
+        case 'p':
+            prof_dump();
+            break;
+        case 'r':
+            prof_reset();
+            uart_puts("[PROF] reset\n");
+            break;
+        default:
+            break;
+        }
+
 #if TEACHING_POLL_ASSIST
         /* Teaching assist only: show pending flag if it ever sets */
         uint32_t st = REG32(GPIO_IRQSTATUS_0);
@@ -605,6 +708,13 @@ int main(void)
         }
 #endif
 
-        asm volatile ("wfi");
+        /* print what was logged, sleep when nothing new came in and no task is waiting */
+        uint32_t claimed = evlog_claim;
+        if (evlog_drain() || ran)
+            continue;
+        cpu_irq_disable();
+        if (evlog_claim == claimed && sched_empty())
+            cpu_wfi();      /* a pending IRQ still wakes us */
+        cpu_irq_enable();
     }
 }
@@ -0,0 +1,84 @@
+#include <stdint.h>
+#include "prof.h"
+#include "uart.h"
+
+struct prof_ent prof_table[PROF_NR] __fast_bss;
+
+static const char *const prof_names[PROF_NR] = {
+    [PROF_IRQ_DISPATCH] = "irq_dispatch",
+    [PROF_GPIO1_ISR]    = "gpio1_isr",
+    [PROF_GPTIMER2_ISR] = "gptimer2_isr",
+    [PROF_UART0_ISR]    = "uart0_isr",
+    [PROF_UART_PUTS]    = "uart_puts",
+    [PROF_INIT_UART]    = "uart_init",
+    [PROF_INIT_GPIO1_MODULE] = "gpio1_module_init",
+    [PROF_INIT_GPIO]    = "gpio_setup",
+    [PROF_INIT_PINMUX]  = "pinmux_setup",
+    [PROF_INIT_TIMER]   = "gptimer2_init",
+    [PROF_INIT_AINTC]   = "aintc_setup",
+};
+
+/* no 64-bit division without libgcc: digits by repeated subtraction */
+static void print_dec_u64(uint64_t v)
+{
+    static const uint64_t pow10[] = {
+        10000000000000000000ull, 1000000000000000000ull, 100000000000000000ull,
+        10000000000000000ull, 1000000000000000ull, 100000000000000ull,
+        10000000000000ull, 1000000000000ull, 100000000000ull, 10000000000ull,
+        1000000000ull, 100000000ull, 10000000ull, 1000000ull, 100000ull,
+        10000ull, 1000ull, 100ull, 10ull, 1ull,
+    };
+    int started = 0;
+
+    for (unsigned i = 0; i < sizeof(pow10) / sizeof(pow10[0]); i++) {
+        char d = '0';
+
+        while (v >= pow10[i]) {
+            v -= pow10[i];
+            d++;
+        }
+        if (d != '0' || started || pow10[i] == 1) {
+            uart_putc(d);
+            started = 1;
+        }
+    }
+}
+
+void prof_init(void)
+{
+    cpu_pmu_events_init(PROF_EV_L1D_REFILL, PROF_EV_BR_MISPRED);
+}
+
+void prof_reset(void)
+{
+    static struct prof_ent zero;     /* never written */
+
+    cpu_irq_disable();
+    for (int i = 0; i < PROF_NR; i++)
+        prof_table[i] = zero;
+    cpu_irq_enable();
+}
+
+void prof_dump(void)
+{
+    uart_puts("[PROF] name: calls, cycles total / max, L1D refills, branch mispredicts\n");
+    for (int i = 0; i < PROF_NR; i++) {
+        struct prof_ent e = prof_table[i];
+
+        if (!e.calls)
+            continue;
+        uart_puts("[PROF] ");
+        uart_puts(prof_names[i]);
+        uart_puts(": ");
+        print_dec_u32(e.calls);
+        uart_puts(", ");
+        print_dec_u64(e.cycles);
+        uart_puts(" / ");
+        print_dec_u32(e.max_cycles);
+        uart_puts(", ");
+        print_dec_u32(e.l1d_refill);
+        uart_puts(", ");
+        print_dec_u32(e.br_mispred);
+        uart_putc('\n');
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <stdint.h>
+#include "cpu.h"
+
+/*
+ * PMU profiling: where the firmware time goes.
+ *
+ *     PROF_BEGIN(PROF_UART_PUTS);
+ *     ...
+ *     PROF_END(PROF_UART_PUTS);
+ *
+ * in one block adds calls, CPU cycles (CCNT), L1 data cache refills and
+ * mispredicted branches (event counters 0/1) to prof_table[id]. Counts are
+ * inclusive: probes inside, and ISRs taken in between, count too. One id
+ * should only be used from one context (main loop or one ISR).
+ * prof_dump() prints the table - 'p' on the console in the main loop.
+ */
+
+#ifndef PROF_ENABLE
+#define PROF_ENABLE 1
+#endif
+
+#define PROF_EV_L1D_REFILL   0x03   /* ARMv7 PMU event numbers */
+#define PROF_EV_BR_MISPRED   0x10
+
+enum prof_id {
+    PROF_IRQ_DISPATCH,
+    PROF_GPIO1_ISR,
+    PROF_GPTIMER2_ISR,
+    PROF_UART0_ISR,
+    PROF_UART_PUTS,
+    PROF_INIT_UART,
+    PROF_INIT_GPIO1_MODULE,
+    PROF_INIT_GPIO,
+    PROF_INIT_PINMUX,
+    PROF_INIT_TIMER,
+    PROF_INIT_AINTC,
+    PROF_NR
+};
+
+struct prof_snap {
+    uint32_t cycles;
+    uint32_t l1d_refill;
+    uint32_t br_mispred;
+};
+
+struct prof_ent {
+    uint64_t cycles;
+    uint32_t calls;
+    uint32_t max_cycles;
+    uint32_t l1d_refill;
+    uint32_t br_mispred;
+};
+
+extern struct prof_ent prof_table[PROF_NR];
+
+static inline void prof_snap(struct prof_snap *s)
+{
+    s->l1d_refill = cpu_pmu_event(0);
+    s->br_mispred = cpu_pmu_event(1);
+    s->cycles = cpu_cycles();
+}
+
+static inline void prof_add(enum prof_id id, const struct prof_snap *s)
+{
+    uint32_t cycles = cpu_cycles() - s->cycles;
+    struct prof_ent *e = &prof_table[id];
+
+    e->l1d_refill += cpu_pmu_event(0) - s->l1d_refill;
+    e->br_mispred += cpu_pmu_event(1) - s->br_mispred;
+    e->cycles += cycles;
+    e->calls++;
+    if (cycles > e->max_cycles)
+        e->max_cycles = cycles;
+}
+
+#if PROF_ENABLE
+#define PROF_BEGIN(id)  struct prof_snap prof_snap_##id; prof_snap(&prof_snap_##id)
+#define PROF_END(id)    prof_add((id), &prof_snap_##id)
+#else
+#define PROF_BEGIN(id)  do { } while (0)
+#define PROF_END(id)    do { } while (0)
+#endif
+
+/* event counters on; after cpu_cycles_init() */
+void prof_init(void);
+void prof_reset(void);
+void prof_dump(void);
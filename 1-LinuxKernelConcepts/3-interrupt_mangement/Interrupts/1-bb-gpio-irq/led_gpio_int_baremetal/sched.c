@@ -0,0 +1,156 @@
+#include <stdint.h>
+#include "sched.h"
+#include "cpu.h"
+#include "evlog.h"
+#include "uart.h"
+
+#define SCHED_QUEUE_MASK    (SCHED_QUEUE_SIZE - 1)
+
+struct sched_ev {
+    uint32_t seq;               /* claim index + 1 once the event is complete */
+    uint32_t arg;
+    struct task *task;
+};
+
+struct sched_queue {
+    struct sched_ev ring[SCHED_QUEUE_SIZE];
+    volatile uint32_t claim;
+    volatile uint32_t tail;
+};
+
+static struct sched_queue sched_queues[SCHED_NR_PRIO] __fast_bss;
+static struct task *sched_tasks[SCHED_MAX_TASKS];
+static uint32_t sched_nr_tasks;
+
+/* the task running now, for sched_watchdog() */
+static struct task *volatile sched_current __fast_bss;
+static volatile uint32_t sched_started __fast_bss;
+static volatile uint32_t sched_flagged __fast_bss;
+
+int sched_add(struct task *t)
+{
+    if (sched_nr_tasks == SCHED_MAX_TASKS || t->prio >= SCHED_NR_PRIO)
+        return -1;
+    t->id = (uint8_t)sched_nr_tasks;
+    sched_tasks[sched_nr_tasks++] = t;
+    return 0;
+}
+
+__fast int sched_post(struct task *t, uint32_t arg)
+{
+    struct sched_queue *q = &sched_queues[t->prio];
+    uint32_t c = __atomic_load_n(&q->claim, __ATOMIC_RELAXED);
+    struct sched_ev *e;
+
+    do {
+        if (c - __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) >= SCHED_QUEUE_SIZE) {
+            t->dropped++;
+            return -1;
+        }
+    } while (!__atomic_compare_exchange_n(&q->claim, &c, c + 1, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    e = &q->ring[c & SCHED_QUEUE_MASK];
+    e->task = t;
+    e->arg = arg;
+    __atomic_store_n(&e->seq, c + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static void sched_overrun(struct task *t, uint32_t cycles)
+{
+    t->overruns++;
+    evlog(EV_TASK_OVERRUN, t->id, cycles);
+}
+
+static void sched_exec(struct task *t, uint32_t arg)
+{
+    uint32_t dt;
+
+    sched_flagged = 0;
+    sched_started = cpu_cycles();
+    __atomic_store_n(&sched_current, t, __ATOMIC_RELEASE);
+
+    t->fn(arg);
+
+    dt = cpu_cycles() - sched_started;
+    __atomic_store_n(&sched_current, (struct task *)0, __ATOMIC_RELEASE);
+
+    t->runs++;
+    if (dt > t->max_cycles)
+        t->max_cycles = dt;
+    /* not flagged by the watchdog while it ran: the end is the first we see */
+    if (dt > t->budget_cycles && !sched_flagged)
+        sched_overrun(t, dt);
+}
+
+int sched_run(void)
+{
+    for (uint32_t prio = 0; prio < SCHED_NR_PRIO; prio++) {
+        struct sched_queue *q = &sched_queues[prio];
+        uint32_t tail = q->tail;
+        struct sched_ev *e = &q->ring[tail & SCHED_QUEUE_MASK];
+        struct task *t;
+        uint32_t arg;
+
+        /* empty, or claimed but not written yet: its ISR was interrupted */
+        if (__atomic_load_n(&e->seq, __ATOMIC_ACQUIRE) != tail + 1)
+            continue;
+
+        t = e->task;
+        arg = e->arg;
+        __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+
+        sched_exec(t, arg);
+        return 1;
+    }
+    return 0;
+}
+
+int sched_empty(void)
+{
+    for (uint32_t prio = 0; prio < SCHED_NR_PRIO; prio++)
+        if (__atomic_load_n(&sched_queues[prio].claim, __ATOMIC_ACQUIRE) != sched_queues[prio].tail)
+            return 0;
+    return 1;
+}
+
+__fast void sched_watchdog(void)
+{
+    struct task *t = __atomic_load_n(&sched_current, __ATOMIC_ACQUIRE);
+    uint32_t dt;
+
+    if (!t || sched_flagged)
+        return;
+    dt = cpu_cycles() - sched_started;
+    if (dt > t->budget_cycles) {
+        sched_flagged = 1;
+        sched_overrun(t, dt);
+    }
+}
+
+const char *sched_task_name(uint32_t id)
+{
+    return id < sched_nr_tasks ? sched_tasks[id]->name : "?";
+}
+
+void sched_print_stats(void)
+{
+    for (uint32_t i = 0; i < sched_nr_tasks; i++) {
+        struct task *t = sched_tasks[i];
+
+        uart_puts("[SCHED] ");
+        uart_puts(t->name);
+        uart_puts(": runs ");
+        print_dec_u32(t->runs);
+        uart_puts(" max ");
+        print_dec_u32(t->max_cycles);
+        uart_puts(" / budget ");
+        print_dec_u32(t->budget_cycles);
+        uart_puts(" cycles, overruns ");
+        print_dec_u32(t->overruns);
+        uart_puts(", dropped ");
+        print_dec_u32(t->dropped);
+        uart_putc('\n');
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+
+/*
+ * Run-to-completion scheduler: an ISR acknowledges its source and posts an
+ * event, the main loop runs the task the event is for.
+ *
+ * One queue per priority level. Posting is the event log's scheme (claim a
+ * slot with a CAS, fill it, publish its sequence number), so ISRs and the
+ * main loop can post without masking IRQs. sched_run() takes the oldest
+ * event of the highest priority level that has one and runs its task to
+ * the end: tasks never preempt each other, only ISRs interrupt them.
+ *
+ * Every task has a CPU budget. A run over it is an overrun, counted and
+ * logged (EV_TASK_OVERRUN). sched_watchdog(), from a periodic ISR, catches
+ * the task still running past its budget too, so one that hangs shows up
+ * instead of silently starving the rest.
+ */
+
+enum sched_prio {
+    SCHED_PRIO_HIGH,
+    SCHED_PRIO_NORMAL,
+    SCHED_PRIO_LOW,
+    SCHED_NR_PRIO
+};
+
+typedef void (*task_fn_t)(uint32_t arg);
+
+struct task {
+    const char *name;
+    task_fn_t fn;
+    uint8_t prio;
+    uint8_t id;                 /* set by sched_add() */
+    uint32_t budget_cycles;
+
+    /* statistics; max_cycles includes ISRs taken during the run */
+    uint32_t runs;
+    uint32_t max_cycles;
+    uint32_t overruns;
+    uint32_t dropped;           /* posts that found the queue full */
+};
+
+/* static initializer, statistics zeroed */
+#define TASK_INIT(name, fn, prio, budget_cycles) \
+    { (name), (fn), (prio), 0, (budget_cycles), 0, 0, 0, 0 }
+
+#define SCHED_QUEUE_SIZE    32u     /* events per priority level, power of two */
+#define SCHED_MAX_TASKS     8
+
+/* 0, or -1 with no room left */
+int sched_add(struct task *t);
+
+/* queue t with arg; 0, or -1 if the queue of its level is full (counted) */
+int sched_post(struct task *t, uint32_t arg);
+
+/* run one posted event, main loop only; 1 if there was one */
+int sched_run(void);
+
+/* nothing posted (checked with IRQs off, it decides on WFI) */
+int sched_empty(void);
+
+/* overrun check of the running task; from a periodic ISR */
+void sched_watchdog(void);
+
+const char *sched_task_name(uint32_t id);
+void sched_print_stats(void);
@@ -1,38 +1,252 @@
 #include <stdint.h>
+#include "uart.h"
+#include "cpu.h"
+#include "prof.h"
 
+#ifndef REG32
 #define REG32(a) (*(volatile uint32_t *)(a))
+#endif
 
 #define UART0_BASE  0x44E09000
 
 #define UART_THR    (UART0_BASE + 0x00)
+#define UART_RHR    (UART0_BASE + 0x00)  /* read */
+#define UART_IER    (UART0_BASE + 0x04)
+#define UART_IIR    (UART0_BASE + 0x08)  /* read */
+#define UART_FCR    (UART0_BASE + 0x08)  /* write */
 #define UART_LSR    (UART0_BASE + 0x14)
 #define UART_LCR    (UART0_BASE + 0x0C)
 #define UART_DLL    (UART0_BASE + 0x00)
 #define UART_DLH    (UART0_BASE + 0x04)
 
-static inline void uart_wait_tx(void)
+#define UART_IER_THR      (1u << 1)
+#define UART_LSR_RXDR     (1u << 0)
+#define UART_LSR_TXFIFOE  (1u << 5)
+#define UART_FCR_ENABLE   0x07      /* FIFO on, both cleared, TX trigger 8 spaces */
+
+#define UART_FIFO_SIZE    64
+#define UART_TX_TRIGGER   8         /* spaces guaranteed when THR IRQ is raised */
+
+/*
+ * TX ring
+ *
+ * uart_puts() only copies into the ring; the bytes go out from the THR-empty
+ * interrupt, a FIFO load (up to 64 bytes) at a time. Producers may be the
+ * main loop and ISRs, so claiming space is a compare-and-swap on tx_reserve
+ * and nothing is ever waited for: a message that does not fit is dropped as
+ * a whole and counted.
+ *
+ * Bytes up to tx_head are complete. A producer interrupted between claiming
+ * and copying holds back the ones claimed after it (by the ISR that
+ * interrupted it) - only the last producer to leave moves tx_head, so the
+ * drain never sends a hole.
+ *
+ * Before uart_tx_irq_enable() the ring is drained by polling, as uart_putc()
+ * always did; whoever gets tx_draining first does it.
+ */
+#define TX_RING_SIZE  2048u         /* power of two */
+#define TX_RING_MASK  (TX_RING_SIZE - 1)
+
+static char tx_buf[TX_RING_SIZE];
+static volatile uint32_t tx_reserve;    /* claimed by producers */
+static volatile uint32_t tx_head;       /* filled */
+static volatile uint32_t tx_tail;       /* sent to the FIFO */
+static volatile uint32_t tx_writers;    /* producers between claim and commit */
+static volatile uint32_t tx_draining;
+static volatile int tx_irq_mode;
+static struct uart_tx_stats tx_stats;
+
+static uint32_t tx_claim(uint32_t len)
 {
-    /* THR empty */
-    while (!(REG32(UART_LSR) & (1 << 5)));
+    uint32_t r = __atomic_load_n(&tx_reserve, __ATOMIC_RELAXED);
+
+    do {
+        uint32_t used = r - __atomic_load_n(&tx_tail, __ATOMIC_ACQUIRE);
+
+        if (len > TX_RING_SIZE - used) {
+            tx_stats.dropped_msgs++;
+            tx_stats.dropped_bytes += len;
+            return UINT32_MAX;
+        }
+        if (used + len > tx_stats.max_used)
+            tx_stats.max_used = used + len;
+    } while (!__atomic_compare_exchange_n(&tx_reserve, &r, r + len, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return r;
+}
+
+static void tx_commit(void)
+{
+    uint32_t h, r;
+
+    if (__atomic_sub_fetch(&tx_writers, 1, __ATOMIC_ACQ_REL))
+        return;
+
+    /* only ever forward: an ISR may have published past us meanwhile */
+    h = __atomic_load_n(&tx_head, __ATOMIC_RELAXED);
+    do {
+        r = __atomic_load_n(&tx_reserve, __ATOMIC_ACQUIRE);
+        if ((int32_t)(r - h) <= 0)
+            return;
+    } while (!__atomic_compare_exchange_n(&tx_head, &h, r, 0,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/* move what fits into the TX FIFO; drain side only */
+static __fast void tx_fill(uint32_t room)
+{
+    uint32_t tail = tx_tail;
+    uint32_t head = __atomic_load_n(&tx_head, __ATOMIC_ACQUIRE);
+
+    while (room-- && tail != head)
+        REG32(UART_THR) = (uint8_t)tx_buf[tail++ & TX_RING_MASK];
+    __atomic_store_n(&tx_tail, tail, __ATOMIC_RELEASE);
+}
+
+static int tx_pending(void)
+{
+    return __atomic_load_n(&tx_head, __ATOMIC_ACQUIRE) != tx_tail;
+}
+
+static void tx_poll_drain(void)
+{
+    do {
+        if (__atomic_exchange_n(&tx_draining, 1, __ATOMIC_ACQUIRE))
+            return;     /* we interrupted the drainer, it sends ours too */
+        while (tx_pending()) {
+            while (!(REG32(UART_LSR) & UART_LSR_TXFIFOE));
+            tx_fill(UART_FIFO_SIZE);
+        }
+        __atomic_store_n(&tx_draining, 0, __ATOMIC_RELEASE);
+        /* an ISR may have queued after our last check and backed off */
+    } while (tx_pending());
+}
+
+static void tx_kick(void)
+{
+    if (tx_irq_mode)
+        REG32(UART_IER) = UART_IER_THR;
+    else
+        tx_poll_drain();
 }
 
 void uart_putc(char c)
 {
-    uart_wait_tx();
-    REG32(UART_THR) = c;
+    uint32_t pos;
+
+    __atomic_add_fetch(&tx_writers, 1, __ATOMIC_ACQ_REL);
+    pos = tx_claim(1);
+    if (pos != UINT32_MAX)
+        tx_buf[pos & TX_RING_MASK] = c;
+    tx_commit();
+    tx_kick();
 }
 
 void uart_puts(const char *s)
 {
-    while (*s) {
-        if (*s == '\n')
-            uart_putc('\r');
-        uart_putc(*s++);
+    uint32_t len = 0, pos;
+    const char *p;
+
+    for (p = s; *p; p++)
+        len += (*p == '\n') ? 2 : 1;
+    if (!len)
+        return;
+
+    PROF_BEGIN(PROF_UART_PUTS);
+    __atomic_add_fetch(&tx_writers, 1, __ATOMIC_ACQ_REL);
+    pos = tx_claim(len);
+    if (pos != UINT32_MAX) {
+        for (p = s; *p; p++) {
+            if (*p == '\n')
+                tx_buf[pos++ & TX_RING_MASK] = '\r';
+            tx_buf[pos++ & TX_RING_MASK] = *p;
+        }
+    }
+    tx_commit();
+    tx_kick();
+    PROF_END(PROF_UART_PUTS);
+}
+
+void print_hex(uint32_t val)
+{
+    static const char hex_chars[] = "0123456789ABCDEF";
+    uart_puts("0x");
+    for (int i = 28; i >= 0; i -= 4)
+        uart_putc(hex_chars[(val >> i) & 0xF]);
+}
+
+void print_dec_u32(uint32_t v)
+{
+    /* simple decimal printing without stdlib */
+    char buf[11];
+    int i = 0;
+    if (v == 0) { uart_putc('0'); return; }
+    while (v > 0 && i < 10) {
+        buf[i++] = (char)('0' + (v % 10));
+        v /= 10;
     }
+    while (i--) uart_putc(buf[i]);
+}
+
+int uart_getc(void)
+{
+    if (!(REG32(UART_LSR) & UART_LSR_RXDR))
+        return -1;
+    return (int)(REG32(UART_RHR) & 0xFF);
+}
+
+__fast void uart_isr(void)
+{
+    /* THR IRQ: reading IIR acknowledges it, the FIFO has >= 8 spaces */
+    uint32_t room = (REG32(UART_LSR) & UART_LSR_TXFIFOE) ? UART_FIFO_SIZE : UART_TX_TRIGGER;
+
+    (void)REG32(UART_IIR);
+    tx_fill(room);
+
+    /* nothing left: the FIFO running empty would raise it again forever */
+    if (!tx_pending())
+        REG32(UART_IER) = 0;
+}
+
+void uart_tx_irq_enable(void)
+{
+    tx_poll_drain();
+    tx_irq_mode = 1;
+    if (tx_pending())
+        REG32(UART_IER) = UART_IER_THR;
+}
+
+void uart_flush(void)
+{
+    if (!tx_irq_mode) {
+        tx_poll_drain();
+        return;
+    }
+    /* needs IRQs enabled: the ISR is what moves tx_tail */
+    while (tx_pending())
+        cpu_wfi();
+}
+
+uint32_t uart_tx_room(void)
+{
+    return TX_RING_SIZE - (__atomic_load_n(&tx_reserve, __ATOMIC_RELAXED) - tx_tail);
+}
+
+void uart_get_tx_stats(struct uart_tx_stats *st)
+{
+    *st = tx_stats;
 }
 
 void uart_init(void)
 {
+    /* FIFO enable only takes while the baud clock is stopped */
+    REG32(UART_LCR) = 0x80;  /* DLAB = 1 */
+    REG32(UART_DLL) = 0;
+    REG32(UART_DLH) = 0;
+    REG32(UART_LCR) = 0x03;
+    REG32(UART_FCR) = UART_FCR_ENABLE;
+    REG32(UART_IER) = 0;
+
     /* 115200 baud assuming 48MHz UART clock */
     REG32(UART_LCR) = 0x80;  /* DLAB = 1 */
     REG32(UART_DLL) = 26;    /* divisor */
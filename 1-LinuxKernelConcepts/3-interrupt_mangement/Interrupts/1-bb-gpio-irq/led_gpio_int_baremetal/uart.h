@@ -1,4 +1,28 @@
 #pragma once
+#include <stdint.h>
+
+#define UART0_IRQ   72
+
+struct uart_tx_stats {
+    uint32_t dropped_msgs;   /* uart_puts/uart_putc calls that did not fit */
+    uint32_t dropped_bytes;
+    uint32_t max_used;       /* ring high-water mark, bytes */
+};
+
 void uart_init(void);
 void uart_putc(char c);
 void uart_puts(const char *s);
+void print_hex(uint32_t val);
+void print_dec_u32(uint32_t v);
+/* received byte, -1 if none; polled */
+int uart_getc(void);
+
+/* switch from polled to interrupt-driven TX; UART0_IRQ must be routed first */
+void uart_tx_irq_enable(void);
+void uart_isr(void);
+
+/* wait until everything queued so far is in the TX FIFO */
+void uart_flush(void);
+/* bytes uart_puts can still queue */
+uint32_t uart_tx_room(void);
+void uart_get_tx_stats(struct uart_tx_stats *st);
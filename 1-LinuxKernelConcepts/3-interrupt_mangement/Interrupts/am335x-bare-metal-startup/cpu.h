@@ -0,0 +1,108 @@
+/*
+ * cpu.h - CP15/CPSR helpers for the AM335x bare-metal firmware
+ * Target: ARM Cortex-A8 (ARMv7-A)
+ *
+ * Kept in one header so the host build (HOST_SIM, see ../am335x-sim) can
+ * replace them.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+#define CPU_MHZ                     1000    /* CCNT counts CPU cycles at 1 GHz */
+
+#ifndef HOST_SIM
+
+/*
+ * Start the PMU cycle counter: enabled, reset, no /64 divider
+ */
+static inline void cpu_cycles_init(void)
+{
+    uint32_t pmcr;
+
+    asm volatile ("mrc p15, 0, %0, c9, c12, 0" : "=r"(pmcr));
+    pmcr |= (1 << 0) | (1 << 2);    /* E: enable, C: reset CCNT */
+    pmcr &= ~(1 << 3);              /* D: count every cycle */
+    asm volatile ("mcr p15, 0, %0, c9, c12, 0" : : "r"(pmcr));
+    asm volatile ("mcr p15, 0, %0, c9, c12, 1" : : "r"(1u << 31));  /* PMCNTENSET.C */
+}
+
+static inline uint32_t cpu_cycles(void)
+{
+    uint32_t c;
+
+    asm volatile ("mrc p15, 0, %0, c9, c13, 0" : "=r"(c));
+    return c;
+}
+
+static inline void cpu_irq_disable(void)
+{
+    asm volatile ("cpsid i" : : : "memory");
+}
+
+static inline void cpu_irq_enable(void)
+{
+    asm volatile ("cpsie i" : : : "memory");
+}
+
+/*
+ * IRQs off, returning the previous CPSR for cpu_irq_restore(); for code
+ * that runs from main and from handlers (which may run with IRQs on)
+ */
+static inline uint32_t cpu_irq_save(void)
+{
+    uint32_t cpsr;
+
+    asm volatile ("mrs %0, cpsr\n\tcpsid i" : "=r"(cpsr) : : "memory");
+    return cpsr;
+}
+
+static inline void cpu_irq_restore(uint32_t cpsr)
+{
+    asm volatile ("msr cpsr_c, %0" : : "r"(cpsr) : "memory");
+}
+
+static inline void cpu_dsb(void)
+{
+    asm volatile ("dsb" : : : "memory");
+}
+
+static inline void cpu_dmb(void)
+{
+    asm volatile ("dmb" : : : "memory");
+}
+
+static inline void cpu_isb(void)
+{
+    asm volatile ("isb" : : : "memory");
+}
+
+static inline void cpu_wfi(void)
+{
+    asm volatile ("wfi" : : : "memory");
+}
+
+#else
+
+static inline void cpu_cycles_init(void) { }
+static inline uint32_t cpu_cycles(void) { return (uint32_t)(sim_cycles_ns() * CPU_MHZ / 1000); }
+static inline void cpu_irq_disable(void) { sim_cpu_irq_enable(0); }
+static inline void cpu_irq_enable(void) { sim_cpu_irq_enable(1); }
+static inline uint32_t cpu_irq_save(void)
+{
+    uint32_t cpsr = sim_cpu_irq_enabled() ? 0 : 0x80;
+
+    sim_cpu_irq_enable(0);
+    return cpsr;
+}
+static inline void cpu_irq_restore(uint32_t cpsr) { sim_cpu_irq_enable(!(cpsr & 0x80)); }
+static inline void cpu_dsb(void) { }
+static inline void cpu_dmb(void) { }
+static inline void cpu_isb(void) { }
+/* cpu_wfi(): a macro of am335x_sim.h */
+
+#endif
+
+#endif /* CPU_H */
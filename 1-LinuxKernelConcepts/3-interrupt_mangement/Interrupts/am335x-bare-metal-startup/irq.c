@@ -0,0 +1,163 @@
+/*
+ * irq.c - Table-driven AINTC interrupt dispatch
+ * Target: ARM Cortex-A8 (ARMv7-A)
+ *
+ * One handler slot per AINTC line (128), so dispatching costs the same
+ * whatever the number of peripherals in use:
+ * 1. Read SIR_IRQ, stop if the spurious flag is set
+ * 2. Call the handler registered for that line, timed with CCNT
+ * 3. NEWIRQAGR, and back to 1 for the next pending IRQ
+ * Step 3 saves an exception exit and entry when IRQs arrive together.
+ *
+ * With irq_nesting set, step 2 runs with IRQs enabled and the AINTC
+ * threshold at the priority of the active IRQ, so only strictly higher
+ * priority IRQs preempt the handler (AM335x TRM, nested interrupt
+ * procedure). The cycle statistics then include the time spent in
+ * preempting handlers.
+ */
+
+#include <stdint.h>
+#include "irq.h"
+#include "cpu.h"
+
+#define AINTC_BASE                  0x48200000
+#define AINTC_SIR_IRQ               (AINTC_BASE + 0x40)
+#define AINTC_CONTROL               (AINTC_BASE + 0x48)
+#define AINTC_IRQ_PRIORITY          (AINTC_BASE + 0x60)
+#define AINTC_THRESHOLD             (AINTC_BASE + 0x68)
+#define AINTC_MIR_CLEAR(n)          (AINTC_BASE + 0x88 + ((n) * 0x20))
+#define AINTC_MIR_SET(n)            (AINTC_BASE + 0x8C + ((n) * 0x20))
+#define AINTC_ILR(n)                (AINTC_BASE + 0x100 + ((n) * 0x04))
+
+#define SIR_ACTIVE_MASK             0x7F
+#define SIR_SPURIOUS_MASK           0xFFFFFF80  /* all set: nothing pending */
+#define IRQ_PRIORITY_MASK           0x7F
+#define ILR_PRIORITY_SHIFT          2           /* bit 0 = 0: IRQ, not FIQ */
+
+/* Pending IRQs handled per exception entry at most */
+#define IRQ_DRAIN_MAX               16
+
+#ifndef REG32
+#define REG32(addr)                 (*((volatile uint32_t *)(addr)))
+#endif
+
+struct irq_slot {
+    irq_handler_t fn;
+    void *ctx;
+    struct irq_stat st;
+};
+
+static struct irq_slot irq_table[NR_IRQS];
+
+volatile uint32_t irq_spurious = 0;
+volatile uint32_t irq_nesting = 1;
+
+/*
+ * Register the handler of an AINTC line (replaces the previous one)
+ */
+int register_irq_handler(uint32_t irq, irq_handler_t fn, void *ctx)
+{
+    if (irq >= NR_IRQS || !fn)
+        return -1;
+
+    irq_table[irq].ctx = ctx;
+    irq_table[irq].fn = fn;
+    return 0;
+}
+
+/*
+ * Set the AINTC priority of an IRQ, IRQ_PRIO_MAX (0) to IRQ_PRIO_MIN (63)
+ */
+void irq_set_priority(uint32_t irq, uint32_t prio)
+{
+    if (irq >= NR_IRQS || prio > IRQ_PRIO_MIN)
+        return;
+
+    REG32(AINTC_ILR(irq)) = prio << ILR_PRIORITY_SHIFT;
+    cpu_dsb();
+}
+
+/*
+ * Enable specific interrupt in AINTC
+ */
+void enable_interrupt(uint32_t int_num)
+{
+    /* Clear mask bit to enable interrupt */
+    REG32(AINTC_MIR_CLEAR(int_num / 32)) = (1u << (int_num % 32));
+    cpu_dsb();
+}
+
+/*
+ * Disable specific interrupt in AINTC
+ */
+void disable_interrupt(uint32_t int_num)
+{
+    /* Set mask bit to disable interrupt */
+    REG32(AINTC_MIR_SET(int_num / 32)) = (1u << (int_num % 32));
+    cpu_dsb();
+}
+
+static inline void irq_call(struct irq_slot *s, uint32_t irq)
+{
+    if (s->fn)
+        s->fn(s->ctx);
+    else
+        disable_interrupt(irq);     /* nobody to clear its source */
+}
+
+/*
+ * C IRQ Handler - called from assembly IRQ handler (SYS mode, IRQs off)
+ */
+void c_irq_handler(void)
+{
+    for (int n = 0; n < IRQ_DRAIN_MAX; n++) {
+        uint32_t sir_irq = REG32(AINTC_SIR_IRQ);
+        uint32_t active_irq = sir_irq & SIR_ACTIVE_MASK;
+        struct irq_slot *s = &irq_table[active_irq];
+        uint32_t nest = irq_nesting;
+        uint32_t t0, dt;
+
+        if ((sir_irq & SIR_SPURIOUS_MASK) == SIR_SPURIOUS_MASK) {
+            if (n == 0)
+                irq_spurious++;
+            break;
+        }
+
+        t0 = cpu_cycles();
+        if (nest) {
+            uint32_t prio = REG32(AINTC_IRQ_PRIORITY) & IRQ_PRIORITY_MASK;
+            uint32_t threshold = REG32(AINTC_THRESHOLD);
+
+            /* Only IRQs above this one may interrupt its handler */
+            REG32(AINTC_THRESHOLD) = prio;
+            REG32(AINTC_CONTROL) = 0x01;
+            cpu_dsb();
+            cpu_irq_enable();
+
+            irq_call(s, active_irq);
+
+            cpu_irq_disable();
+            REG32(AINTC_THRESHOLD) = threshold;
+        } else {
+            irq_call(s, active_irq);
+        }
+        dt = cpu_cycles() - t0;
+
+        s->st.count++;
+        if (s->st.count == 1 || dt < s->st.min_cycles)
+            s->st.min_cycles = dt;
+        if (dt > s->st.max_cycles)
+            s->st.max_cycles = dt;
+
+        /* Acknowledge: SIR_IRQ then shows the next pending IRQ, if any */
+        if (!nest)
+            REG32(AINTC_CONTROL) = 0x01;
+        cpu_dsb();
+    }
+}
+
+void irq_get_stat(uint32_t irq, struct irq_stat *st)
+{
+    if (irq < NR_IRQS)
+        *st = irq_table[irq].st;
+}
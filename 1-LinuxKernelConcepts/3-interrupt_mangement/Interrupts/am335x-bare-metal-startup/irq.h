@@ -0,0 +1,38 @@
+/*
+ * irq.h - Table-driven AINTC interrupt dispatch
+ * Target: ARM Cortex-A8 (ARMv7-A)
+ */
+
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+#define NR_IRQS                     128
+
+/* AINTC priorities: 0 is the highest, 63 the lowest (reset value: 0) */
+#define IRQ_PRIO_MAX                0
+#define IRQ_PRIO_MIN                63
+
+typedef void (*irq_handler_t)(void *ctx);
+
+/*
+ * Per-IRQ statistics, handler time only (CCNT cycles)
+ */
+struct irq_stat {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+};
+
+int register_irq_handler(uint32_t irq, irq_handler_t fn, void *ctx);
+void irq_set_priority(uint32_t irq, uint32_t prio);
+void enable_interrupt(uint32_t int_num);
+void disable_interrupt(uint32_t int_num);
+void c_irq_handler(void);
+void irq_get_stat(uint32_t irq, struct irq_stat *st);
+
+extern volatile uint32_t irq_spurious;
+extern volatile uint32_t irq_nesting;      /* 1: preemption by higher priority IRQs */
+
+#endif /* IRQ_H */
@@ -6,9 +6,15 @@
  * - AINTC (ARM Interrupt Controller) initialization
  * - DMTimer interrupt setup and handling  
  * - Proper interrupt acknowledgment flow
+ * - Nested interrupts by priority, with a timer latency measurement
+ * - MMU and caches, with a before/after benchmark
+ * - Tickless software timers (timer.c), compared against the 1ms tick
  */
 
 #include <stdint.h>
+#include "cpu.h"
+#include "irq.h"
+#include "timer.h"
 
 /*
  * AM335x Memory Map - Key Peripheral Base Addresses
@@ -53,40 +59,130 @@
 
 /* Interrupt numbers */
 #define INT_DMTIMER1MS              67  /* DMTimer1MS interrupt */
+#define INT_GPIO1A                  98  /* GPIO1 line A, raised by software here */
+#define INT_GPIO1B                  99  /* GPIO1 line B, ISR entry benchmark */
+
+/* AINTC priorities (0 highest): the timer preempts GPIO handlers */
+#define PRIO_DMTIMER1MS             IRQ_PRIO_MAX
+#define PRIO_GPIO1A                 32
+#define PRIO_GPIO1B                 16
+
+/* Timer reload for 1ms at 24MHz, one count is 125/3 ns */
+#define DMTIMER_RELOAD              (0xFFFFFFFF - 24000 + 1)
+#define DMTIMER_TICKS_TO_NS(t)      ((t) * 125 / 3)
+
+/*
+ * Latency measurement: a 1.5ms GPIO handler every 3ms, 2s per mode. It is
+ * raised right after a tick, so it has to outlast the 1ms period for the
+ * next tick to land in it.
+ */
+#define LAT_GPIO_BUSY_US            1500
+#define LAT_GPIO_EVERY_MS           3
+#define LAT_RUN_MS                  2000
+
+/* Idle comparison: the same two periodic jobs on the tick, then tickless */
+#define JOB_FAST_MS                 10
+#define JOB_SLOW_MS                 250
+#define IDLE_RUN_MS                 2000
+#define IDLE_CYCLES_PER_0_01PCT     (IDLE_RUN_MS * CPU_MHZ / 10)
+#define DELAY_TEST_MS               50
+
+/* Cache benchmark: CRC-32 of a 16KB buffer, ISR entry samples */
+#define BENCH_BUF_SIZE              16384
+#define BENCH_ISR_SAMPLES           64
 
 /* Control Module for clock enable */
 #define CM_WKUP_BASE                0x44E00400
 #define CM_WKUP_TIMER1_CLKCTRL      (CM_WKUP_BASE + 0xC4)
 
 /* Register access macros */
+#ifndef REG32
 #define REG32(addr)                 (*((volatile uint32_t *)(addr)))
+#endif
 
 /*
  * Global variables
  */
 static volatile uint32_t timer_count = 0;
 
+/*
+ * Timer IRQ latency (overflow to dmtimer1ms_isr), indexed by irq_nesting:
+ * lat_result[0] non-nested, lat_result[1] nested. Read them with JTAG.
+ */
+struct lat_result {
+    uint32_t samples;
+    uint32_t max_ns;
+    uint32_t gpio_runs;
+};
+
+#define LAT_OFF                     2
+
+volatile struct lat_result lat_result[2];
+static volatile uint32_t lat_phase = LAT_OFF;
+
+/*
+ * MMU/caches benchmark, cache_bench[0] before mmu_enable(), [1] after.
+ * isr_entry: software IRQ raised to its handler running, in CPU cycles.
+ */
+struct cache_bench {
+    uint32_t compute_cycles;
+    uint32_t crc;
+    uint32_t isr_entry_min;
+    uint32_t isr_entry_max;
+};
+
+volatile struct cache_bench cache_bench[2];
+static volatile uint32_t swirq_cycles;
+static uint8_t bench_buf[BENCH_BUF_SIZE];
+
+/*
+ * 1ms tick vs tickless timers, idle_result[0] on the tick, [1] on the
+ * timer service. idle: time in WFI, IRQ handlers excluded.
+ */
+struct idle_result {
+    uint32_t irqs;
+    uint32_t irqs_per_s;
+    uint32_t idle_cycles;
+    uint32_t idle_pct_x100;     /* 9990 = 99.90% */
+    uint32_t jobs;
+};
+
+volatile struct idle_result idle_result[2];
+static volatile uint32_t tickless_jobs;
+static volatile uint32_t tickless_done;
+
+/* Seconds since the timer service took over, read it with JTAG */
+volatile uint32_t uptime_s;
+
+/* delay_ms(DELAY_TEST_MS) as measured with the cycle counter */
+volatile uint32_t delay_us;
+
 /*
  * Function prototypes
  */
 void init_aintc(void);
 void init_dmtimer(void);
-void enable_interrupt(uint32_t int_num);
-void disable_interrupt(uint32_t int_num);
-void c_irq_handler(void);
-void delay_ms(uint32_t ms);
+static void dmtimer1ms_isr(void *ctx);
+static void gpio1a_isr(void *ctx);
+static void measure_timer_latency(void);
+static void gpio1b_isr(void *ctx);
+static void run_cache_bench(volatile struct cache_bench *res);
+static void run_tick_idle(void);
+static void run_tickless_idle(void);
+static void heartbeat(void *ctx);
+void mmu_enable(void);                  /* startup.s */
 
 /*
  * Memory barrier functions
  */
 static inline void memory_barrier(void)
 {
-    asm volatile ("dmb" : : : "memory");
+    cpu_dmb();
 }
 
 static inline void instruction_sync_barrier(void)
 {
-    asm volatile ("isb" : : : "memory");
+    cpu_isb();
 }
 
 /*
@@ -94,7 +190,7 @@ static inline void instruction_sync_barrier(void)
  */
 static inline void enable_irq(void)
 {
-    asm volatile ("cpsie i" : : : "memory");
+    cpu_irq_enable();
 }
 
 /*
@@ -102,7 +198,7 @@ static inline void enable_irq(void)
  */
 static inline void disable_irq(void)
 {
-    asm volatile ("cpsid i" : : : "memory");
+    cpu_irq_disable();
 }
 
 /*
@@ -110,36 +206,60 @@ static inline void disable_irq(void)
  */
 int main(void)
 {
+    /* CCNT for the per-IRQ handler statistics */
+    cpu_cycles_init();
+    
     /* Initialize AINTC interrupt controller */
     init_aintc();
     
     /* Initialize and start DMTimer */
     init_dmtimer();
     
-    /* Enable DMTimer interrupt */
+    /* Route and enable DMTimer and GPIO interrupts */
+    register_irq_handler(INT_DMTIMER1MS, dmtimer1ms_isr, 0);
+    irq_set_priority(INT_DMTIMER1MS, PRIO_DMTIMER1MS);
     enable_interrupt(INT_DMTIMER1MS);
     
+    register_irq_handler(INT_GPIO1A, gpio1a_isr, 0);
+    irq_set_priority(INT_GPIO1A, PRIO_GPIO1A);
+    enable_interrupt(INT_GPIO1A);
+    
+    register_irq_handler(INT_GPIO1B, gpio1b_isr, 0);
+    irq_set_priority(INT_GPIO1B, PRIO_GPIO1B);
+    enable_interrupt(INT_GPIO1B);
+    
     /* Enable IRQs globally */
     enable_irq();
     
-    /* Main application loop */
-    uint32_t last_count = 0;
+    /* Uncached baseline, then MMU + caches + branch prediction on */
+    run_cache_bench(&cache_bench[0]);
+    mmu_enable();
+    run_cache_bench(&cache_bench[1]);
+    
+    /* Worst-case timer latency under GPIO load, without and with nesting */
+    measure_timer_latency();
+    
+    /* Interrupt rate and idle time, 1ms tick then tickless */
+    run_tick_idle();
+    timer_init();
+    run_tickless_idle();
+    
+    /* delay_ms() on the timer service: a one-shot, WFI until it fires */
+    uint32_t delay_start = cpu_cycles();
+    delay_ms(DELAY_TEST_MS);
+    delay_us = (cpu_cycles() - delay_start) / CPU_MHZ;
+    
+    /*
+     * Main application loop: from here on the work runs from software
+     * timers, the CPU sleeps until the next deadline
+     */
+    static struct sw_timer heartbeat_timer;
+    
+    timer_start(&heartbeat_timer, 1000 * 1000, 1000 * 1000, heartbeat, 0);
     
     while (1) {
-        /* Check if timer interrupt occurred */
-        if (timer_count != last_count) {
-            last_count = timer_count;
-            
-            /* Simple indication that we're running */
-            /* In real hardware, this could toggle an LED */
-            if ((timer_count % 1000) == 0) {
-                /* Print every second (assuming 1ms timer) */
-                /* Note: No UART in this minimal example */
-            }
-        }
-        
         /* Wait for interrupt */
-        asm volatile ("wfi");
+        cpu_wfi();
     }
     
     return 0;
@@ -169,11 +289,13 @@ void init_aintc(void)
     REG32(AINTC_MIR_SET(0)) = 0xFFFFFFFF;
     REG32(AINTC_MIR_SET(1)) = 0xFFFFFFFF;
     REG32(AINTC_MIR_SET(2)) = 0xFFFFFFFF;
+    REG32(AINTC_MIR_SET(3)) = 0xFFFFFFFF;
     
     /* Clear any pending interrupts */
     REG32(AINTC_ISR_CLEAR(0)) = 0xFFFFFFFF;
     REG32(AINTC_ISR_CLEAR(1)) = 0xFFFFFFFF;
     REG32(AINTC_ISR_CLEAR(2)) = 0xFFFFFFFF;
+    REG32(AINTC_ISR_CLEAR(3)) = 0xFFFFFFFF;
     
     /* Enable new IRQ/FIQ generation */
     REG32(AINTC_CONTROL) = 0x03;
@@ -200,7 +322,7 @@ void init_dmtimer(void)
     
     /* Configure timer for 1ms periodic interrupt */
     /* Assuming 24MHz clock, for 1ms: reload = 0xFFFFFFFF - 24000 + 1 */
-    uint32_t reload_value = 0xFFFFFFFF - 24000 + 1;
+    uint32_t reload_value = DMTIMER_RELOAD;
     
     /* Set reload value */
     REG32(DMTIMER1MS_BASE + DMTIMER_TLDR) = reload_value;
@@ -219,87 +341,251 @@ void init_dmtimer(void)
 }
 
 /*
- * Enable specific interrupt in AINTC
+ * DMTimer1MS overflow handler, dispatched from c_irq_handler (irq.c)
  */
-void enable_interrupt(uint32_t int_num)
+static void dmtimer1ms_isr(void *ctx)
 {
-    uint32_t reg_offset = int_num / 32;
-    uint32_t bit_offset = int_num % 32;
+    /* Counts since the overflow reloaded TCRR */
+    uint32_t lat_ticks = REG32(DMTIMER1MS_BASE + DMTIMER_TCRR) - DMTIMER_RELOAD;
+    uint32_t phase = lat_phase;
     
-    /* Clear mask bit to enable interrupt */
-    REG32(AINTC_MIR_CLEAR(reg_offset)) = (1 << bit_offset);
+    (void)ctx;
     
-    memory_barrier();
+    if (phase != LAT_OFF) {
+        uint32_t ns = DMTIMER_TICKS_TO_NS(lat_ticks);
+        
+        lat_result[phase].samples++;
+        if (ns > lat_result[phase].max_ns)
+            lat_result[phase].max_ns = ns;
+    }
+    
+    /* Clear timer interrupt flag */
+    REG32(DMTIMER1MS_BASE + DMTIMER_TISR) = 0x02;
+    
+    /* Increment our timer counter */
+    timer_count++;
 }
 
 /*
- * Disable specific interrupt in AINTC
+ * GPIO1 line A handler: stands in for a slow handler, busy for
+ * LAT_GPIO_BUSY_US. Raised by software through AINTC ISR_SET.
  */
-void disable_interrupt(uint32_t int_num)
+static void gpio1a_isr(void *ctx)
 {
-    uint32_t reg_offset = int_num / 32;
-    uint32_t bit_offset = int_num % 32;
+    uint32_t t0 = cpu_cycles();
     
-    /* Set mask bit to disable interrupt */
-    REG32(AINTC_MIR_SET(reg_offset)) = (1 << bit_offset);
+    (void)ctx;
     
-    memory_barrier();
+    REG32(AINTC_ISR_CLEAR(INT_GPIO1A / 32)) = 1u << (INT_GPIO1A % 32);
+    
+    if (lat_phase != LAT_OFF)
+        lat_result[lat_phase].gpio_runs++;
+    
+    while (cpu_cycles() - t0 < LAT_GPIO_BUSY_US * CPU_MHZ)
+        ;
 }
 
 /*
- * C IRQ Handler - called from assembly IRQ handler
- * This function implements the complete interrupt handling flow:
- * 1. Read interrupt ID from AINTC
- * 2. Handle the specific interrupt
- * 3. Clear peripheral interrupt 
- * 4. Acknowledge AINTC
+ * Run LAT_RUN_MS with the GPIO load, first non-nested then nested, and
+ * keep the worst timer latency of each in lat_result[]. Non-nested, the
+ * timer waits for the GPIO handler to finish (LAT_GPIO_BUSY_US less the
+ * 1ms period); nested, it preempts it.
  */
-void c_irq_handler(void)
+static void measure_timer_latency(void)
 {
-    /* Read active IRQ number from AINTC */
-    uint32_t sir_irq = REG32(AINTC_SIR_IRQ);
-    uint32_t active_irq = sir_irq & 0x7F;  /* Bits 6:0 contain IRQ number */
-    
-    /* Check if this is a spurious interrupt */
-    if (active_irq == 0x7F) {
-        /* Spurious interrupt, just acknowledge and return */
-        REG32(AINTC_CONTROL) = 0x01;  /* New IRQ acknowledge */
-        return;
+    for (uint32_t nest = 0; nest < 2; nest++) {
+        uint32_t start = timer_count;
+        uint32_t last = start;
+        
+        irq_nesting = nest;
+        lat_phase = nest;
+        
+        while ((timer_count - start) < LAT_RUN_MS) {
+            if ((timer_count - last) >= LAT_GPIO_EVERY_MS) {
+                last = timer_count;
+                REG32(AINTC_ISR_SET(INT_GPIO1A / 32)) = 1u << (INT_GPIO1A % 32);
+            }
+            cpu_wfi();
+        }
     }
     
-    /* Handle specific interrupts */
-    switch (active_irq) {
-        case INT_DMTIMER1MS:
-            /* DMTimer1MS overflow interrupt */
-            
-            /* Clear timer interrupt flag */
-            REG32(DMTIMER1MS_BASE + DMTIMER_TISR) = 0x02;
-            
-            /* Increment our timer counter */
-            timer_count++;
-            
-            break;
-            
-        default:
-            /* Unknown interrupt - just clear and acknowledge */
-            break;
+    lat_phase = LAT_OFF;
+    irq_nesting = 1;
+}
+
+/*
+ * GPIO1 line B handler: timestamp for the ISR entry benchmark
+ */
+static void gpio1b_isr(void *ctx)
+{
+    swirq_cycles = cpu_cycles();
+    
+    (void)ctx;
+    
+    REG32(AINTC_ISR_CLEAR(INT_GPIO1B / 32)) = 1u << (INT_GPIO1B % 32);
+}
+
+/*
+ * Bitwise CRC-32, a load/branch heavy loop that fits in L1 once cached
+ */
+static uint32_t bench_crc32(const uint8_t *p, uint32_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    
+    while (len--) {
+        crc ^= *p++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
     }
+    return ~crc;
+}
+
+/*
+ * Compute loop time and ISR entry latency (software IRQ raised through
+ * AINTC ISR_SET to gpio1b_isr running, dispatch included)
+ */
+static void run_cache_bench(volatile struct cache_bench *res)
+{
+    uint32_t t0;
     
-    /* Acknowledge interrupt to AINTC to allow new IRQs */
-    REG32(AINTC_CONTROL) = 0x01;  /* New IRQ acknowledge */
+    for (uint32_t i = 0; i < BENCH_BUF_SIZE; i++)
+        bench_buf[i] = (uint8_t)(i * 7);
     
-    memory_barrier();
+    t0 = cpu_cycles();
+    res->crc = bench_crc32(bench_buf, BENCH_BUF_SIZE);
+    res->compute_cycles = cpu_cycles() - t0;
+    
+    res->isr_entry_min = 0xFFFFFFFF;
+    res->isr_entry_max = 0;
+    for (int i = 0; i < BENCH_ISR_SAMPLES; i++) {
+        uint32_t dt;
+        
+        swirq_cycles = 0;
+        t0 = cpu_cycles();
+        REG32(AINTC_ISR_SET(INT_GPIO1B / 32)) = 1u << (INT_GPIO1B % 32);
+        while (swirq_cycles == 0)
+            ;
+        dt = swirq_cycles - t0;
+        
+        if (dt < res->isr_entry_min)
+            res->isr_entry_min = dt;
+        if (dt > res->isr_entry_max)
+            res->isr_entry_max = dt;
+    }
 }
 
 /*
- * Simple delay function using timer count
- * Note: This requires timer interrupts to be working
+ * IRQs handled so far, all lines
  */
-void delay_ms(uint32_t ms)
+static uint32_t irq_total(void)
 {
-    uint32_t start_count = timer_count;
+    struct irq_stat st;
+    uint32_t n = 0;
     
-    while ((timer_count - start_count) < ms) {
-        asm volatile ("wfi");
+    for (uint32_t irq = 0; irq < NR_IRQS; irq++) {
+        irq_get_stat(irq, &st);
+        n += st.count;
     }
+    return n;
+}
+
+/*
+ * WFI with IRQs off: the cycles up to the wakeup are idle, the handler
+ * that runs once IRQs are back on is not
+ */
+static uint32_t idle_wfi(void)
+{
+    uint32_t t0;
+    
+    disable_irq();
+    t0 = cpu_cycles();
+    cpu_wfi();
+    t0 = cpu_cycles() - t0;
+    enable_irq();
+    
+    return t0;
+}
+
+static void idle_result_set(volatile struct idle_result *res, uint32_t irqs,
+                            uint32_t idle, uint32_t jobs)
+{
+    res->irqs = irqs;
+    res->irqs_per_s = irqs * 1000 / IDLE_RUN_MS;
+    res->idle_cycles = idle;
+    res->idle_pct_x100 = idle / IDLE_CYCLES_PER_0_01PCT;
+    res->jobs = jobs;
+}
+
+/*
+ * Tick-driven: dmtimer1ms_isr every 1ms, main checks what is due after
+ * each wakeup
+ */
+static void run_tick_idle(void)
+{
+    uint32_t start = timer_count;
+    uint32_t fast = start, slow = start;
+    uint32_t irqs = irq_total();
+    uint32_t idle = 0, jobs = 0;
+    
+    while ((timer_count - start) < IDLE_RUN_MS) {
+        uint32_t now;
+        
+        idle += idle_wfi();
+        
+        now = timer_count;
+        if ((now - fast) >= JOB_FAST_MS) {
+            fast += JOB_FAST_MS;
+            jobs++;
+        }
+        if ((now - slow) >= JOB_SLOW_MS) {
+            slow += JOB_SLOW_MS;
+            jobs++;
+        }
+    }
+    
+    idle_result_set(&idle_result[0], irq_total() - irqs, idle, jobs);
+}
+
+static void tickless_job(void *ctx)
+{
+    (void)ctx;
+    tickless_jobs++;
+}
+
+static void tickless_end(void *ctx)
+{
+    (void)ctx;
+    tickless_done = 1;
+}
+
+/*
+ * Tickless: the same jobs as software timers, the DMTimer only
+ * interrupts when one is due
+ */
+static void run_tickless_idle(void)
+{
+    static struct sw_timer fast, slow, end;
+    uint32_t irqs = irq_total();
+    uint32_t idle = 0;
+    
+    timer_start(&fast, JOB_FAST_MS * 1000, JOB_FAST_MS * 1000, tickless_job, 0);
+    timer_start(&slow, JOB_SLOW_MS * 1000, JOB_SLOW_MS * 1000, tickless_job, 0);
+    timer_start(&end, IDLE_RUN_MS * 1000, 0, tickless_end, 0);
+    
+    while (!tickless_done)
+        idle += idle_wfi();
+    
+    timer_stop(&fast);
+    timer_stop(&slow);
+    idle_result_set(&idle_result[1], irq_total() - irqs, idle, tickless_jobs);
+}
+
+/*
+ * Once a second from the timer service.
+ * In real hardware, this could toggle an LED.
+ */
+static void heartbeat(void *ctx)
+{
+    (void)ctx;
+    uptime_s++;
 }
\ No newline at end of file
@@ -12,14 +12,20 @@
 
 /* External symbols from linker script */
 .extern _stack_top
-.extern _vector_table_start
-.extern _vector_table_end
 .extern _bss_start
 .extern _bss_end
 .extern main
 
 /* Global entry point */
 .global _start
+.global mmu_enable
+
+/* Translation table: 4096 x 1MB section descriptors (linker.lds, 16KB aligned) */
+.extern _ttb_start
+
+/* Section descriptor attributes (short descriptor format, AP = full access) */
+.equ SECTION_NORMAL_WB, 0x00001C0E  /* TEX=001 C=1 B=1: normal, write-back write-allocate */
+.equ SECTION_DEVICE,    0x00000C16  /* TEX=000 C=0 B=1 XN: shared device */
 
 .section .text
 
@@ -45,11 +51,12 @@ _start:
     bl disable_caches
     
     /*
-     * Configure System Control Register (SCTLR) for high vectors
-     * Set V bit (bit 13) to use high exception vectors at 0xFFFF0000
+     * Configure System Control Register (SCTLR) for low vectors
+     * Clear V bit (bit 13): the vectors are at VBAR, not 0xFFFF0000,
+     * where the AM335x has no memory while the MMU is off
      */
     mrc p15, 0, r0, c1, c0, 0   /* Read SCTLR */
-    orr r0, r0, #(1 << 13)      /* Set V bit for high vectors */
+    bic r0, r0, #(1 << 13)      /* Clear V bit: vectors at VBAR */
     bic r0, r0, #(1 << 0)       /* Clear M bit (disable MMU) */
     bic r0, r0, #(1 << 2)       /* Clear C bit (disable D-cache) */
     bic r0, r0, #(1 << 12)      /* Clear I bit (disable I-cache) */
@@ -57,11 +64,12 @@ _start:
     isb                         /* Instruction Synchronization Barrier */
     
     /*
-     * Copy vector table to high vector address (0xFFFF0000)
-     * Note: On AM335x, this requires proper memory mapping setup
-     * For simplicity in bare-metal, we'll set up a basic mapping
+     * Point VBAR at vector_table in DDR. The map is flat, so the same
+     * address holds before and after mmu_enable(): IRQs work in both
      */
-    bl copy_vector_table
+    ldr r0, =vector_table
+    mcr p15, 0, r0, c12, c0, 0  /* VBAR */
+    isb
     
     /* Set up stack pointer for SVC mode */
     ldr sp, =_stack_top
@@ -72,6 +80,12 @@ _start:
     /* Clear BSS section */
     bl clear_bss
     
+    /*
+     * Build the translation table. main() turns the MMU and caches on
+     * with mmu_enable(), after measuring the uncached baseline.
+     */
+    bl setup_mmu_table
+    
     /* Jump to C main function */
     bl main
     
@@ -82,7 +96,7 @@ halt:
 
 /*
  * disable_caches: Safely disable all caches and MMU
- * Corrupts: r0, r1
+ * Corrupts: r0-r5, r7-r11
  */
 disable_caches:
     /* Disable caches in SCTLR */
@@ -96,8 +110,10 @@ disable_caches:
     mov r0, #0
     mcr p15, 0, r0, c7, c5, 0   /* ICIALLU - Invalidate all I-cache */
     
-    /* Invalidate D-cache */
-    mcr p15, 0, r0, c7, c6, 0   /* DCISW - Invalidate all D-cache */
+    /* Clean and invalidate D-cache / L2, so nothing stale or dirty is left */
+    mov r8, lr                  /* No stack yet */
+    bl dcache_clean_inv_all
+    mov lr, r8
     
     /* Invalidate TLBs */
     mcr p15, 0, r0, c8, c7, 0   /* TLBIALL - Invalidate all TLBs */
@@ -108,32 +124,137 @@ disable_caches:
     bx lr
 
 /*
- * copy_vector_table: Copy vector table to high memory
- * For bare-metal without MMU, we simulate high vectors by
- * setting up a simple mapping or copying to accessible high memory
- * Corrupts: r0, r1, r2, r3
+ * dcache_clean_inv_all: Clean and invalidate all data/unified cache levels
+ * by set/way (ARMv7 ARM, walks CLIDR up to the level of coherency)
+ * Corrupts: r0-r5, r7, r9-r11
+ */
+dcache_clean_inv_all:
+    dmb
+    mrc p15, 1, r0, c0, c0, 1   /* CLIDR */
+    ands r3, r0, #0x07000000    /* LoC */
+    mov r3, r3, lsr #23         /* LoC * 2 */
+    beq dci_done
+    mov r10, #0                 /* Cache level * 2 */
+dci_level:
+    add r2, r10, r10, lsr #1    /* Level * 3 */
+    mov r1, r0, lsr r2
+    and r1, r1, #7              /* Cache type at this level */
+    cmp r1, #2
+    blt dci_next                /* No data cache */
+    mcr p15, 2, r10, c0, c0, 0  /* CSSELR: select level */
+    isb
+    mrc p15, 1, r1, c0, c0, 0   /* CCSIDR */
+    and r2, r1, #7
+    add r2, r2, #4              /* log2(line size) */
+    ldr r4, =0x3FF
+    ands r4, r4, r1, lsr #3     /* Ways - 1 */
+    clz r5, r4                  /* Way shift */
+    ldr r7, =0x7FFF
+    ands r7, r7, r1, lsr #13    /* Sets - 1 */
+dci_set:
+    mov r9, r4
+dci_way:
+    orr r11, r10, r9, lsl r5
+    orr r11, r11, r7, lsl r2
+    mcr p15, 0, r11, c7, c14, 2 /* DCCISW */
+    subs r9, r9, #1
+    bge dci_way
+    subs r7, r7, #1
+    bge dci_set
+dci_next:
+    add r10, r10, #2
+    cmp r3, r10
+    bgt dci_level
+dci_done:
+    mov r10, #0
+    mcr p15, 2, r10, c0, c0, 0  /* CSSELR back to L1 */
+    dsb
+    isb
+    bx lr
+
+/*
+ * setup_mmu_table: Flat (VA = PA) 1MB section map
+ *   0x40000000-0x7FFFFFFF  device, XN (L3/L4 peripherals, 0x44E00000, 0x48000000, ...)
+ *   0x40300000             normal write-back (OCMC SRAM)
+ *   0x80000000-0x9FFFFFFF  normal write-back (512MB DDR, vectors included)
+ *   everything else        fault
+ * Corrupts: r0-r4
+ */
+setup_mmu_table:
+    ldr r0, =_ttb_start
+    mov r1, #0
+    mov r2, #4096
+    mov r3, #0                  /* Fault */
+    mov r4, lr
+    bl map_sections
+    
+    mov r1, #0x400
+    mov r2, #0x400
+    ldr r3, =SECTION_DEVICE
+    bl map_sections
+    
+    ldr r1, =0x403
+    mov r2, #1
+    ldr r3, =SECTION_NORMAL_WB
+    bl map_sections
+    
+    mov r1, #0x800
+    mov r2, #0x200
+    bl map_sections
+    
+    dsb
+    bx r4
+
+/*
+ * map_sections: r0 = table, r1 = first MB, r2 = MB count, r3 = attributes
+ * Corrupts: r1, r2, r12
  */
-copy_vector_table:
-    /* For simplicity, we'll use a CPU-specific approach
-     * On AM335x, high vectors need proper memory controller setup
-     * For this example, we'll set up basic high vector support */
-    
-    /* Get vector table source and destination */
-    ldr r0, =vector_table       /* Source: our vector table */
-    ldr r1, =0xFFFF0000         /* Destination: high vectors */
-    mov r2, #0x20               /* Size: 8 vectors * 4 bytes each */
-    
-copy_loop:
-    cmp r2, #0
-    beq copy_done
-    ldr r3, [r0], #4
-    str r3, [r1], #4
-    sub r2, r2, #4
-    b copy_loop
-    
-copy_done:
+map_sections:
+    orr r12, r3, r1, lsl #20
+    str r12, [r0, r1, lsl #2]
+    add r1, r1, #1
+    subs r2, r2, #1
+    bne map_sections
     bx lr
 
+/*
+ * mmu_enable: Turn on MMU, D-cache, I-cache and branch prediction
+ * void mmu_enable(void), callable from C with IRQs enabled
+ * Corrupts: r0-r3 (AAPCS)
+ */
+mmu_enable:
+    push {r4-r11, lr}
+    mrs r6, cpsr
+    cpsid if
+    
+    bl dcache_clean_inv_all
+    
+    ldr r0, =_ttb_start         /* Table walks: non-cacheable */
+    mcr p15, 0, r0, c2, c0, 0   /* TTBR0 */
+    mov r0, #0
+    mcr p15, 0, r0, c2, c0, 2   /* TTBCR: TTBR0 only, 16KB table */
+    mov r0, #1
+    mcr p15, 0, r0, c3, c0, 0   /* DACR: domain 0 client */
+    
+    mov r0, #0
+    mcr p15, 0, r0, c8, c7, 0   /* TLBIALL */
+    mcr p15, 0, r0, c7, c5, 0   /* ICIALLU */
+    mcr p15, 0, r0, c7, c5, 6   /* BPIALL */
+    dsb
+    isb
+    
+    mrc p15, 0, r0, c1, c0, 0   /* Read SCTLR */
+    orr r0, r0, #(1 << 0)       /* M: MMU */
+    orr r0, r0, #(1 << 2)       /* C: D-cache */
+    orr r0, r0, #(1 << 11)      /* Z: branch prediction */
+    orr r0, r0, #(1 << 12)      /* I: I-cache */
+    mcr p15, 0, r0, c1, c0, 0   /* Write SCTLR */
+    isb
+    
+    /* VBAR still points at vector_table: same VA, now cached */
+    msr cpsr_c, r6
+    pop {r4-r11, pc}
+
 /*
  * setup_stacks: Initialize stack pointers for different modes
  * Corrupts: r0, r1
@@ -161,6 +282,11 @@ setup_stacks:
     ldr sp, =_stack_top
     sub sp, sp, #0x4000         /* ABT stack: 4KB below UND */
     
+    /* System mode stack: IRQ handlers run here (nested IRQs) */
+    cps #0x1F                   /* Switch to System mode */
+    ldr sp, =_stack_top
+    sub sp, sp, #0x5000         /* SYS stack: rest of the 64KB */
+    
     /* Return to SVC mode */
     cps #0x13                   /* Back to SVC mode */
     
@@ -185,19 +311,29 @@ clear_done:
     bx lr
 
 /*
- * Exception vectors - will be copied to 0xFFFF0000
- * Each entry is a single instruction that branches to the handler
+ * Exception vectors, used in place through VBAR (32-byte aligned)
+ * Each entry loads the handler address from the table right after the
+ * vectors, PC-relative
  */
 .align 5
 vector_table:
-    ldr pc, =reset_handler      /* Reset */
-    ldr pc, =undef_handler      /* Undefined Instruction */
-    ldr pc, =swi_handler        /* Software Interrupt */
-    ldr pc, =prefetch_handler   /* Prefetch Abort */
-    ldr pc, =data_handler       /* Data Abort */
+    ldr pc, reset_addr          /* Reset */
+    ldr pc, undef_addr          /* Undefined Instruction */
+    ldr pc, swi_addr            /* Software Interrupt */
+    ldr pc, prefetch_addr       /* Prefetch Abort */
+    ldr pc, data_addr           /* Data Abort */
     nop                         /* Reserved */
-    ldr pc, =irq_handler        /* IRQ */
-    ldr pc, =fiq_handler        /* FIQ */
+    ldr pc, irq_addr            /* IRQ */
+    ldr pc, fiq_addr            /* FIQ */
+
+reset_addr:     .word reset_handler
+undef_addr:     .word undef_handler
+swi_addr:       .word swi_handler
+prefetch_addr:  .word prefetch_handler
+data_addr:      .word data_handler
+                .word 0
+irq_addr:       .word irq_handler
+fiq_addr:       .word fiq_handler
 
 /*
  * Exception Handlers
@@ -224,17 +360,34 @@ data_handler:
 /*
  * IRQ Handler - Main interrupt handler
  * This is where interrupts from AINTC will be processed
+ *
+ * Reentrant: c_irq_handler may re-enable IRQs around a handler so that a
+ * higher priority IRQ preempts it (see irq.c). A nested IRQ entry would
+ * overwrite lr_irq/spsr_irq, so both are pushed to the SYS mode stack and
+ * the handler runs in SYS mode, where lr is not banked with IRQ mode.
+ * Only the AAPCS caller-saved registers need saving, r4-r11 are preserved
+ * by the C code.
  */
 irq_handler:
     /* Save context */
     sub lr, lr, #4              /* Adjust return address */
-    stmfd sp!, {r0-r12, lr}     /* Save registers */
+    srsdb sp!, #0x1F            /* Push lr_irq, spsr_irq to SYS stack */
+    cps #0x1F                   /* Switch to SYS mode */
+    push {r0-r3, r12, lr}       /* Save caller-saved registers, lr_sys */
+    
+    /* AAPCS: 8-byte aligned stack at the call */
+    and r1, sp, #4
+    sub sp, sp, r1
+    push {r1, r2}
     
     /* Call C IRQ handler */
     bl c_irq_handler
     
     /* Restore context */
-    ldmfd sp!, {r0-r12, pc}^    /* Restore registers and return */
+    pop {r1, r2}
+    add sp, sp, r1
+    pop {r0-r3, r12, lr}        /* Restore registers */
+    rfeia sp!                   /* Return: pc, cpsr from SYS stack */
 
 fiq_handler:
     /* FIQ handler (Fast Interrupt) */
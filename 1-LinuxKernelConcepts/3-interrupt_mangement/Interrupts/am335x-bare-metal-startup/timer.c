@@ -0,0 +1,246 @@
+/*
+ * timer.c - Tickless software timers on DMTimer1ms
+ * Target: ARM Cortex-A8 (ARMv7-A)
+ *
+ * Instead of a 1ms tick, DMTimer1ms counts freely at 24 MHz (0 to
+ * 0xFFFFFFFF, then wraps) and its match register is set to the earliest
+ * deadline in the queue. The only interrupts are then:
+ * 1. Match: a software timer is due
+ * 2. Overflow, every 179s: extends the counter to 64 bits
+ * 3. A software one (AINTC ISR_SET) when a deadline is too close to arm
+ *    the match for it, or already passed
+ * so an idle CPU stays in WFI until the next thing it has to do.
+ *
+ * The queue is a singly linked list sorted by deadline: inserting walks
+ * it, expiring only looks at the head. Callbacks run from the IRQ, with
+ * the queue unlocked (they may start and stop timers).
+ */
+
+#include <stdint.h>
+#include "timer.h"
+#include "irq.h"
+#include "cpu.h"
+
+#define DMTIMER1MS_BASE             0x44E31000
+#define DMTIMER_TIOCP_CFG           (DMTIMER1MS_BASE + 0x10)
+#define DMTIMER_TISTAT              (DMTIMER1MS_BASE + 0x14)
+#define DMTIMER_TISR                (DMTIMER1MS_BASE + 0x18)
+#define DMTIMER_TIER                (DMTIMER1MS_BASE + 0x1C)
+#define DMTIMER_TCLR                (DMTIMER1MS_BASE + 0x24)
+#define DMTIMER_TCRR                (DMTIMER1MS_BASE + 0x28)
+#define DMTIMER_TLDR                (DMTIMER1MS_BASE + 0x2C)
+#define DMTIMER_TWPS                (DMTIMER1MS_BASE + 0x34)
+#define DMTIMER_TMAR                (DMTIMER1MS_BASE + 0x38)
+
+#define TISR_MAT                    (1 << 0)
+#define TISR_OVF                    (1 << 1)
+#define TCLR_ST                     (1 << 0)
+#define TCLR_AR                     (1 << 1)
+#define TCLR_CE                     (1 << 6)
+#define TWPS_W_PEND_TMAR            (1 << 4)
+
+#define AINTC_BASE                  0x48200000
+#define AINTC_ISR_SET(n)            (AINTC_BASE + 0x90 + ((n) * 0x20))
+#define AINTC_ISR_CLEAR(n)          (AINTC_BASE + 0x94 + ((n) * 0x20))
+
+#define TIMER_IRQ                   67  /* DMTimer1ms */
+
+/* Closer than this, the counter may pass TMAR before the write lands */
+#define ARM_MIN_TICKS               TIMER_US_TO_TICKS(2)
+/* Further than this, arm for this and look again: the match is 32-bit */
+#define ARM_MAX_TICKS               0x80000000u
+
+#ifndef REG32
+#define REG32(addr)                 (*((volatile uint32_t *)(addr)))
+#endif
+
+static struct sw_timer *timer_head;
+static uint32_t timer_wraps;
+
+/*
+ * Raise the timer IRQ by software: expiry runs from the IRQ only
+ */
+static void timer_kick(void)
+{
+    REG32(AINTC_ISR_SET(TIMER_IRQ / 32)) = 1u << (TIMER_IRQ % 32);
+}
+
+uint64_t timer_now(void)
+{
+    uint32_t cpsr = cpu_irq_save();
+    uint32_t hi = timer_wraps;
+    uint32_t lo = REG32(DMTIMER_TCRR);
+
+    /* Wrapped, and the overflow not handled yet: lo may be from either side */
+    if (REG32(DMTIMER_TISR) & TISR_OVF) {
+        lo = REG32(DMTIMER_TCRR);
+        hi++;
+    }
+    cpu_irq_restore(cpsr);
+
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * Program the match for the head of the queue (IRQs off)
+ */
+static void timer_arm(void)
+{
+    uint64_t now, delta;
+    uint32_t match;
+
+    if (!timer_head)
+        return;
+
+    now = timer_now();
+    if (timer_head->deadline <= now + ARM_MIN_TICKS) {
+        timer_kick();
+        return;
+    }
+
+    delta = timer_head->deadline - now;
+    if (delta > ARM_MAX_TICKS)
+        delta = ARM_MAX_TICKS;
+    match = (uint32_t)now + (uint32_t)delta;
+
+    while (REG32(DMTIMER_TWPS) & TWPS_W_PEND_TMAR);
+    REG32(DMTIMER_TMAR) = match;
+
+    /* Passed while we were writing it: no match before the next wrap */
+    if ((int32_t)(match - REG32(DMTIMER_TCRR)) <= 0)
+        timer_kick();
+}
+
+static void timer_insert(struct sw_timer *t)
+{
+    struct sw_timer **pp = &timer_head;
+
+    while (*pp && (*pp)->deadline <= t->deadline)
+        pp = &(*pp)->next;
+    t->next = *pp;
+    *pp = t;
+}
+
+static void timer_unlink(struct sw_timer *t)
+{
+    struct sw_timer **pp;
+
+    for (pp = &timer_head; *pp; pp = &(*pp)->next) {
+        if (*pp == t) {
+            *pp = t->next;
+            return;
+        }
+    }
+}
+
+/*
+ * DMTimer1ms handler: match, overflow or kick, run what is due, re-arm
+ */
+static void timer_isr(void *ctx)
+{
+    uint32_t cpsr = cpu_irq_save();
+    uint32_t st = REG32(DMTIMER_TISR);
+
+    (void)ctx;
+
+    REG32(DMTIMER_TISR) = st & (TISR_MAT | TISR_OVF);
+    REG32(AINTC_ISR_CLEAR(TIMER_IRQ / 32)) = 1u << (TIMER_IRQ % 32);
+    if (st & TISR_OVF)
+        timer_wraps++;
+
+    while (timer_head && timer_head->deadline <= timer_now()) {
+        struct sw_timer *t = timer_head;
+
+        timer_head = t->next;
+        if (t->period) {
+            t->deadline += t->period;
+            timer_insert(t);
+        }
+
+        cpu_irq_restore(cpsr);
+        t->fn(t->ctx);
+        cpsr = cpu_irq_save();
+    }
+
+    timer_arm();
+    cpu_irq_restore(cpsr);
+}
+
+/*
+ * Reset DMTimer1ms and restart it free-running from 0, match and
+ * overflow interrupts on. Replaces whatever handler its IRQ had.
+ */
+void timer_init(void)
+{
+    uint32_t cpsr = cpu_irq_save();
+
+    REG32(DMTIMER_TIOCP_CFG) = 0x02;            /* Soft reset */
+    while ((REG32(DMTIMER_TISTAT) & 0x01) == 0);
+
+    timer_head = 0;
+    timer_wraps = 0;
+
+    REG32(DMTIMER_TLDR) = 0;
+    REG32(DMTIMER_TCRR) = 0;
+    REG32(DMTIMER_TMAR) = 0xFFFFFFFF;
+    REG32(DMTIMER_TISR) = TISR_MAT | TISR_OVF;
+    REG32(AINTC_ISR_CLEAR(TIMER_IRQ / 32)) = 1u << (TIMER_IRQ % 32);
+    REG32(DMTIMER_TIER) = TISR_MAT | TISR_OVF;
+
+    register_irq_handler(TIMER_IRQ, timer_isr, 0);
+    REG32(DMTIMER_TCLR) = TCLR_ST | TCLR_AR | TCLR_CE;
+    cpu_dsb();
+
+    cpu_irq_restore(cpsr);
+}
+
+/*
+ * Queue t (need not be initialised the first time), or requeue it
+ */
+void timer_start(struct sw_timer *t, uint32_t delay_us, uint32_t period_us,
+                 timer_fn_t fn, void *ctx)
+{
+    uint32_t cpsr = cpu_irq_save();
+
+    timer_unlink(t);
+    t->fn = fn;
+    t->ctx = ctx;
+    t->period = TIMER_US_TO_TICKS(period_us);
+    t->deadline = timer_now() + TIMER_US_TO_TICKS(delay_us);
+    timer_insert(t);
+
+    if (timer_head == t)
+        timer_arm();
+    cpu_irq_restore(cpsr);
+}
+
+void timer_stop(struct sw_timer *t)
+{
+    uint32_t cpsr = cpu_irq_save();
+
+    /* The match may stay on its deadline: the IRQ then finds nothing due */
+    timer_unlink(t);
+    cpu_irq_restore(cpsr);
+}
+
+static void delay_done(void *ctx)
+{
+    *(volatile uint32_t *)ctx = 1;
+}
+
+void delay_ms(uint32_t ms)
+{
+    volatile uint32_t done = 0;
+    struct sw_timer t;
+
+    timer_start(&t, ms * 1000, 0, delay_done, (void *)&done);
+
+    /* Checked with IRQs off: a wakeup between the test and WFI isn't lost */
+    cpu_irq_disable();
+    while (!done) {
+        cpu_wfi();
+        cpu_irq_enable();
+        cpu_irq_disable();
+    }
+    cpu_irq_enable();
+}
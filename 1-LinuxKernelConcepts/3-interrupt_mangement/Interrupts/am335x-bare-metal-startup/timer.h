@@ -0,0 +1,45 @@
+/*
+ * timer.h - Tickless software timers on DMTimer1ms
+ * Target: ARM Cortex-A8 (ARMv7-A)
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+#define TIMER_CLK_MHZ               24      /* DMTimer1ms functional clock */
+#define TIMER_US_TO_TICKS(us)       ((uint32_t)(us) * TIMER_CLK_MHZ)
+
+typedef void (*timer_fn_t)(void *ctx);
+
+/*
+ * A software timer, owned by the caller. The fields are the timer
+ * service's while it is queued.
+ */
+struct sw_timer {
+    struct sw_timer *next;
+    uint64_t deadline;          /* timer ticks */
+    uint32_t period;            /* ticks, 0: one-shot */
+    timer_fn_t fn;
+    void *ctx;
+};
+
+/* Take over DMTimer1ms (and its IRQ): free-running, match on the next deadline */
+void timer_init(void);
+
+/* Ticks since timer_init(), 24 MHz, does not wrap */
+uint64_t timer_now(void);
+
+/*
+ * Run fn(ctx) in delay_us, then every period_us (0: once), from the
+ * DMTimer1ms IRQ. Restarts t if it is already queued. Both below 178 s.
+ */
+void timer_start(struct sw_timer *t, uint32_t delay_us, uint32_t period_us,
+                 timer_fn_t fn, void *ctx);
+void timer_stop(struct sw_timer *t);
+
+/* Sleep in WFI for ms; needs timer_init() and IRQs enabled */
+void delay_ms(uint32_t ms);
+
+#endif /* TIMER_H */
@@ -0,0 +1,994 @@
+#include <setjmp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "am335x_sim.h"
+
+/*
+ * Peripheral model behind am335x_sim.h.
+ *
+ * Registers without a model behind them behave as plain memory (last value
+ * written, 0 before), which is enough for clock/pinmux setup code. The
+ * modelled ones:
+ *
+ *   UART0   THR/LSR/IER/IIR/FCR/LCR/DLL/DLH/SSR, a 64-byte TX FIFO drained
+ *           at the baud rate the divisor gives, THR-empty interrupt
+ *   AINTC   MIR/MIR_SET/MIR_CLEAR, ISR_SET/ISR_CLEAR, ITR, PENDING_IRQ, ILR
+ *           priorities, THRESHOLD, SIR_IRQ/IRQ_PRIORITY latched until
+ *           NEWIRQAGR, soft reset
+ *   GPIO0-3 OE/DATAIN/DATAOUT/SET/CLEAR, rising/falling/level detection,
+ *           IRQSTATUS(_RAW/_SET/_CLR) for both lines, soft reset
+ *   DMTIMER 1ms (0x44E31000) and 2-7: 24 MHz counter with prescaler,
+ *           overflow with auto-reload, compare match, TTGR, both register
+ *           layouts
+ *   WDT1    disable sequence, no write posting
+ */
+
+struct sim_stats sim_stats;
+uint32_t sim_access_ns = 100;   /* L4 peripheral access, roughly */
+uint32_t sim_cp15_ns = 5;
+
+static void sim_init(void);
+static uint64_t next_due;       /* no model event before; 0: unknown */
+
+static uint64_t now_ns;
+
+/* ---------------- plain registers ---------------- */
+
+#define REGFILE_BITS 12
+#define REGFILE_SIZE (1u << REGFILE_BITS)
+
+static struct {
+    uint32_t addr;
+    uint32_t val;
+    int used;
+} regfile[REGFILE_SIZE];
+
+static uint32_t *regfile_slot(uint32_t addr)
+{
+    uint32_t i = (addr * 2654435761u) >> (32 - REGFILE_BITS);
+
+    for (uint32_t n = 0; n < REGFILE_SIZE; n++, i = (i + 1) & (REGFILE_SIZE - 1)) {
+        if (regfile[i].used && regfile[i].addr == addr)
+            return &regfile[i].val;
+        if (!regfile[i].used) {
+            regfile[i].used = 1;
+            regfile[i].addr = addr;
+            return &regfile[i].val;
+        }
+    }
+    fprintf(stderr, "sim: register file full\n");
+    abort();
+}
+
+/* ---------------- UART0 ---------------- */
+
+#define UART0_BASE      0x44E09000u
+#define UART_FIFO_SIZE  64
+#define UART_TX_TRIGGER 8
+#define UART_CLK_HZ     48000000ull
+
+static struct {
+    uint32_t ier, lcr, dll, dlh, fcr;
+    uint8_t fifo[UART_FIFO_SIZE];
+    uint32_t fifo_head, fifo_count;
+    int shifting;               /* a byte is in the shift register */
+    char shift;
+    uint64_t shift_done_ns;
+    uint32_t overruns;
+    void (*tx_hook)(char c);
+} uart;
+
+static uint64_t uart_char_ns(void)
+{
+    uint32_t div = uart.dll | (uart.dlh << 8);
+
+    if (!div)
+        return 0;       /* baud clock stopped */
+    /* start + 8 data + stop, 16x oversampling */
+    return 10ull * 16 * div * 1000000000ull / UART_CLK_HZ;
+}
+
+static uint32_t uart_fifo_size(void)
+{
+    return (uart.fcr & 1) ? UART_FIFO_SIZE : 1;
+}
+
+static void uart_load_shifter(uint64_t t)
+{
+    uint64_t char_ns = uart_char_ns();
+
+    if (uart.shifting || !uart.fifo_count || !char_ns)
+        return;
+    uart.shift = (char)uart.fifo[uart.fifo_head];
+    uart.fifo_head = (uart.fifo_head + 1) % UART_FIFO_SIZE;
+    uart.fifo_count--;
+    uart.shifting = 1;
+    uart.shift_done_ns = t + char_ns;
+}
+
+static void uart_update(void)
+{
+    while (uart.shifting && uart.shift_done_ns <= now_ns) {
+        uint64_t t = uart.shift_done_ns;
+
+        uart.shifting = 0;
+        if (uart.tx_hook)
+            uart.tx_hook(uart.shift);
+        else
+            putchar(uart.shift);
+        uart_load_shifter(t);
+    }
+}
+
+static int uart_irq_level(void)
+{
+    if (!(uart.ier & (1u << 1)))
+        return 0;
+    return uart_fifo_size() - uart.fifo_count >= ((uart.fcr & 1) ? UART_TX_TRIGGER : 1);
+}
+
+static int uart_read(uint32_t off, uint32_t *val)
+{
+    int dlab = uart.lcr & 0x80;
+
+    switch (off) {
+    case 0x00: *val = dlab ? uart.dll : 0; return 1;     /* RHR: nothing received */
+    case 0x04: *val = dlab ? uart.dlh : uart.ier; return 1;
+    case 0x08: *val = uart_irq_level() ? 0x02 : 0x01; return 1;    /* IIR */
+    case 0x0C: *val = uart.lcr; return 1;
+    case 0x14:                                           /* LSR */
+        *val = (uart.fifo_count ? 0 : (1u << 5)) |
+               (uart.fifo_count || uart.shifting ? 0 : (1u << 6));
+        return 1;
+    case 0x44: *val = uart.fifo_count == uart_fifo_size(); return 1;  /* SSR */
+    }
+    return 0;
+}
+
+static int uart_write(uint32_t off, uint32_t val)
+{
+    int dlab = uart.lcr & 0x80;
+
+    switch (off) {
+    case 0x00:
+        if (dlab) {
+            uart.dll = val & 0xFF;
+        } else if (uart.fifo_count == uart_fifo_size()) {
+            uart.overruns++;
+        } else {
+            uart.fifo[(uart.fifo_head + uart.fifo_count) % UART_FIFO_SIZE] = (uint8_t)val;
+            uart.fifo_count++;
+            uart_load_shifter(now_ns);
+        }
+        return 1;
+    case 0x04:
+        if (dlab)
+            uart.dlh = val & 0x3F;
+        else
+            uart.ier = val & 0xFF;
+        return 1;
+    case 0x08:                                          /* FCR */
+        if (val & (1u << 2))
+            uart.fifo_count = 0;
+        uart.fcr = val;
+        return 1;
+    case 0x0C:
+        uart.lcr = val & 0xFF;
+        return 1;
+    }
+    return 0;
+}
+
+void sim_uart_set_tx_hook(void (*fn)(char c))
+{
+    uart.tx_hook = fn;
+}
+
+uint32_t sim_uart_overruns(void)
+{
+    return uart.overruns;
+}
+
+/* ---------------- GPIO0-3 ---------------- */
+
+#define GPIO_NR_BANKS   4
+
+static const struct {
+    uint32_t base;
+    uint32_t irq_a, irq_b;
+} gpio_hw[GPIO_NR_BANKS] = {
+    { 0x44E07000u, 96, 97 },
+    { 0x4804C000u, 98, 99 },
+    { 0x481AC000u, 32, 33 },
+    { 0x481AE000u, 62, 63 },
+};
+
+static struct gpio_bank {
+    uint32_t sysconfig, ctrl, oe, dataout;
+    uint32_t pins;              /* external levels */
+    uint32_t raw, en[2];
+    uint32_t level0, level1, rising, falling, debounce;
+} gpio[GPIO_NR_BANKS];
+
+static void gpio_reset(struct gpio_bank *g)
+{
+    uint32_t pins = g->pins;
+
+    memset(g, 0, sizeof(*g));
+    g->oe = 0xFFFFFFFFu;
+    g->pins = pins;
+}
+
+static uint32_t gpio_datain(const struct gpio_bank *g)
+{
+    return (g->pins & g->oe) | (g->dataout & ~g->oe);
+}
+
+/* level detection holds the status while the level lasts */
+static void gpio_levels(struct gpio_bank *g)
+{
+    uint32_t in = gpio_datain(g);
+
+    g->raw |= (g->level0 & ~in) | (g->level1 & in);
+}
+
+static void gpio_pins_changed(struct gpio_bank *g, uint32_t before)
+{
+    uint32_t after = gpio_datain(g);
+    uint32_t rose = ~before & after, fell = before & ~after;
+
+    g->raw |= (rose & g->rising) | (fell & g->falling);
+    gpio_levels(g);
+}
+
+static int gpio_line(const struct gpio_bank *g, int line)
+{
+    return (g->raw & g->en[line]) != 0;
+}
+
+static int gpio_read(struct gpio_bank *g, uint32_t off, uint32_t *val)
+{
+    switch (off) {
+    case 0x010: *val = g->sysconfig; return 1;
+    case 0x024: case 0x028: *val = g->raw; return 1;
+    case 0x02C: *val = g->raw & g->en[0]; return 1;
+    case 0x030: *val = g->raw & g->en[1]; return 1;
+    case 0x034: case 0x03C: *val = g->en[0]; return 1;
+    case 0x038: case 0x040: *val = g->en[1]; return 1;
+    case 0x114: *val = 1; return 1;                     /* SYSSTATUS: reset done */
+    case 0x130: *val = g->ctrl; return 1;
+    case 0x134: *val = g->oe; return 1;
+    case 0x138: *val = gpio_datain(g); return 1;
+    case 0x13C: case 0x190: case 0x194: *val = g->dataout; return 1;
+    case 0x140: *val = g->level0; return 1;
+    case 0x144: *val = g->level1; return 1;
+    case 0x148: *val = g->rising; return 1;
+    case 0x14C: *val = g->falling; return 1;
+    case 0x150: *val = g->debounce; return 1;
+    }
+    return 0;
+}
+
+static int gpio_write(struct gpio_bank *g, uint32_t off, uint32_t val)
+{
+    uint32_t before = gpio_datain(g);
+
+    switch (off) {
+    case 0x010:
+        if (val & (1u << 1))
+            gpio_reset(g);                              /* SOFTRESET, self-clearing */
+        g->sysconfig = val & ~(1u << 1);
+        return 1;
+    case 0x024: case 0x028: g->raw |= val; return 1;    /* IRQSTATUS_RAW: software set */
+    case 0x02C: case 0x030: g->raw &= ~val; gpio_levels(g); return 1;
+    case 0x034: g->en[0] |= val; return 1;
+    case 0x038: g->en[1] |= val; return 1;
+    case 0x03C: g->en[0] &= ~val; return 1;
+    case 0x040: g->en[1] &= ~val; return 1;
+    case 0x130: g->ctrl = val; return 1;
+    case 0x134: g->oe = val; break;
+    case 0x13C: g->dataout = val; break;
+    case 0x140: g->level0 = val; gpio_levels(g); return 1;
+    case 0x144: g->level1 = val; gpio_levels(g); return 1;
+    case 0x148: g->rising = val; return 1;
+    case 0x14C: g->falling = val; return 1;
+    case 0x150: g->debounce = val; return 1;
+    case 0x190: g->dataout &= ~val; break;
+    case 0x194: g->dataout |= val; break;
+    default:
+        return 0;
+    }
+    gpio_pins_changed(g, before);
+    return 1;
+}
+
+static struct gpio_bank *gpio_find(uint32_t addr)
+{
+    for (int i = 0; i < GPIO_NR_BANKS; i++)
+        if (addr - gpio_hw[i].base < 0x1000)
+            return &gpio[i];
+    return NULL;
+}
+
+void sim_gpio_set(uint32_t bank, uint32_t pin, int level)
+{
+    struct gpio_bank *g = &gpio[bank % GPIO_NR_BANKS];
+    uint32_t before;
+
+    sim_init();
+    before = gpio_datain(g);
+    if (level)
+        g->pins |= 1u << pin;
+    else
+        g->pins &= ~(1u << pin);
+    gpio_pins_changed(g, before);
+}
+
+uint32_t sim_gpio_out(uint32_t bank)
+{
+    return gpio[bank % GPIO_NR_BANKS].dataout;
+}
+
+/* ---------------- DMTimers ---------------- */
+
+#define TIMER_CLK_HZ    24000000ull     /* CLK_M_OSC, the reset clock select */
+#define TIMER_NR        7
+
+#define TCLR_ST         (1u << 0)
+#define TCLR_AR         (1u << 1)
+#define TCLR_PRE        (1u << 5)
+#define TCLR_CE         (1u << 6)
+
+#define TIMER_IT_MAT    (1u << 0)
+#define TIMER_IT_OVF    (1u << 1)
+
+/* register offsets; DMTimer1ms has its own layout (TISR/TIER, no RAW/CLR) */
+enum { T_TIOCP, T_TISTAT, T_RAW, T_STATUS, T_EN_SET, T_EN_CLR, T_TCLR, T_TCRR,
+       T_TLDR, T_TTGR, T_TWPS, T_TMAR, T_NR };
+
+static const uint32_t timer_layout[2][T_NR] = {
+    /* DMTimer2-7 */
+    { 0x10, 0xFFF, 0x24, 0x28, 0x2C, 0x30, 0x38, 0x3C, 0x40, 0x44, 0x48, 0x4C },
+    /* DMTimer1ms */
+    { 0x10, 0x14, 0xFFF, 0x18, 0x1C, 0xFFF, 0x24, 0x28, 0x2C, 0x30, 0x34, 0x38 },
+};
+
+static const struct {
+    uint32_t base;
+    uint32_t irq;
+    int is_1ms;
+} timer_hw[TIMER_NR] = {
+    { 0x44E31000u, 67, 1 },
+    { 0x48040000u, 68, 0 },
+    { 0x48042000u, 69, 0 },
+    { 0x48044000u, 92, 0 },
+    { 0x48046000u, 93, 0 },
+    { 0x48048000u, 94, 0 },
+    { 0x4804A000u, 95, 0 },
+};
+
+static struct dmtimer {
+    uint32_t tclr, tldr, tmar, raw, en;
+    uint32_t cnt_base;          /* TCRR at ns_base */
+    uint64_t ns_base;
+    uint64_t ovf_ns, mat_ns;    /* next events, UINT64_MAX: none */
+} timers[TIMER_NR];
+
+static uint64_t timer_div(const struct dmtimer *t)
+{
+    return (t->tclr & TCLR_PRE) ? 2ull << ((t->tclr >> 2) & 7) : 1;
+}
+
+static uint64_t timer_ticks_ns(const struct dmtimer *t, uint64_t ticks)
+{
+    uint64_t q = ticks * timer_div(t) * 1000000000ull;
+
+    return (q + TIMER_CLK_HZ - 1) / TIMER_CLK_HZ;
+}
+
+static uint32_t timer_count(const struct dmtimer *t)
+{
+    if (!(t->tclr & TCLR_ST))
+        return t->cnt_base;
+    return t->cnt_base + (uint32_t)((now_ns - t->ns_base) * TIMER_CLK_HZ /
+                                    (1000000000ull * timer_div(t)));
+}
+
+static void timer_rebase(struct dmtimer *t, uint64_t ns, uint32_t cnt)
+{
+    t->ns_base = ns;
+    t->cnt_base = cnt;
+    t->ovf_ns = t->mat_ns = UINT64_MAX;
+    if (!(t->tclr & TCLR_ST))
+        return;
+    t->ovf_ns = ns + timer_ticks_ns(t, 0x100000000ull - cnt);
+    if ((t->tclr & TCLR_CE) && t->tmar > cnt)
+        t->mat_ns = ns + timer_ticks_ns(t, t->tmar - cnt);
+}
+
+static void timer_update(struct dmtimer *t)
+{
+    for (;;) {
+        if (t->mat_ns <= now_ns && t->mat_ns <= t->ovf_ns) {
+            t->raw |= TIMER_IT_MAT;
+            t->mat_ns = UINT64_MAX;
+        } else if (t->ovf_ns <= now_ns) {
+            uint64_t at = t->ovf_ns;
+
+            t->raw |= TIMER_IT_OVF;
+            if (!(t->tclr & TCLR_AR))
+                t->tclr &= ~TCLR_ST;    /* one-shot: stops at 0 */
+            timer_rebase(t, at, (t->tclr & TCLR_AR) ? t->tldr : 0);
+        } else {
+            break;
+        }
+    }
+}
+
+static int timer_irq_level(const struct dmtimer *t)
+{
+    return (t->raw & t->en & 7) != 0;
+}
+
+static int timer_reg(int i, uint32_t off)
+{
+    const uint32_t *l = timer_layout[timer_hw[i].is_1ms];
+
+    for (int r = 0; r < T_NR; r++)
+        if (l[r] == off)
+            return r;
+    return -1;
+}
+
+static int timer_read(int i, uint32_t off, uint32_t *val)
+{
+    struct dmtimer *t = &timers[i];
+
+    switch (timer_reg(i, off)) {
+    case T_TIOCP: *val = 0; return 1;
+    case T_TISTAT: *val = 1; return 1;                  /* reset done */
+    case T_RAW: *val = t->raw; return 1;
+    case T_STATUS: *val = timer_hw[i].is_1ms ? t->raw : (t->raw & t->en); return 1;
+    case T_EN_SET: case T_EN_CLR: *val = t->en; return 1;
+    case T_TCLR: *val = t->tclr; return 1;
+    case T_TCRR: *val = timer_count(t); return 1;
+    case T_TLDR: *val = t->tldr; return 1;
+    case T_TWPS: *val = 0; return 1;                    /* no posted writes pending */
+    case T_TMAR: *val = t->tmar; return 1;
+    }
+    return 0;
+}
+
+static int timer_write(int i, uint32_t off, uint32_t val)
+{
+    struct dmtimer *t = &timers[i];
+    uint32_t cnt = timer_count(t);
+
+    switch (timer_reg(i, off)) {
+    case T_TIOCP:
+        if (val & (timer_hw[i].is_1ms ? 2 : 1))         /* SOFTRESET */
+            memset(t, 0, sizeof(*t));
+        timer_rebase(t, now_ns, 0);
+        return 1;
+    case T_RAW: t->raw |= val & 7; return 1;
+    case T_STATUS: t->raw &= ~val; return 1;
+    case T_EN_SET:
+        if (timer_hw[i].is_1ms)
+            t->en = val & 7;                            /* TIER: plain register */
+        else
+            t->en |= val & 7;
+        return 1;
+    case T_EN_CLR: t->en &= ~val; return 1;
+    case T_TCLR: t->tclr = val; break;
+    case T_TCRR: cnt = val; break;
+    case T_TLDR: t->tldr = val; return 1;
+    case T_TTGR: cnt = t->tldr; break;
+    case T_TWPS: return 1;
+    case T_TMAR: t->tmar = val; break;
+    default:
+        return 0;
+    }
+    timer_rebase(t, now_ns, cnt);
+    return 1;
+}
+
+static int timer_find(uint32_t addr)
+{
+    for (int i = 0; i < TIMER_NR; i++)
+        if (addr - timer_hw[i].base < 0x1000)
+            return i;
+    return -1;
+}
+
+static uint64_t timers_next_ns(void)
+{
+    uint64_t next = UINT64_MAX;
+
+    for (int i = 0; i < TIMER_NR; i++) {
+        if (timers[i].ovf_ns < next)
+            next = timers[i].ovf_ns;
+        if (timers[i].mat_ns < next)
+            next = timers[i].mat_ns;
+    }
+    return next;
+}
+
+/* ---------------- WDT1 ---------------- */
+
+#define WDT1_BASE       0x44E35000u
+
+static struct {
+    uint32_t wspr;
+    int disabled;
+} wdt;
+
+static int wdt_read(uint32_t off, uint32_t *val)
+{
+    switch (off) {
+    case 0x14: *val = 1; return 1;                      /* WDST: reset done */
+    case 0x34: *val = 0; return 1;                      /* WWPS: no write pending */
+    case 0x48: *val = wdt.wspr; return 1;
+    }
+    return 0;
+}
+
+static int wdt_write(uint32_t off, uint32_t val)
+{
+    if (off != 0x48)
+        return 0;
+    if (val == 0x5555 && wdt.wspr == 0xAAAA)
+        wdt.disabled = 1;
+    else if (val == 0xBBBB && wdt.wspr == 0x4444)
+        wdt.disabled = 0;
+    wdt.wspr = val;
+    return 1;
+}
+
+int sim_wdt_running(void)
+{
+    return !wdt.disabled;
+}
+
+/* ---------------- AINTC ---------------- */
+
+#define AINTC_BASE      0x48200000u
+#define AINTC_NR_IRQS   128
+#define SIR_SPURIOUS    0xFFFFFF80u
+
+static struct {
+    uint32_t mir[4];
+    uint32_t isr_sw[4];         /* ISR_SET */
+    uint32_t ilr[AINTC_NR_IRQS];
+    uint32_t threshold;
+    uint32_t sysconfig, protection, idle;
+    int latched;                /* IRQ generated, waiting for NEWIRQAGR */
+    uint32_t sir, prio;
+} aintc;
+
+static void aintc_reset(void)
+{
+    memset(&aintc, 0, sizeof(aintc));
+    for (int n = 0; n < 4; n++)
+        aintc.mir[n] = 0xFFFFFFFFu;
+    aintc.threshold = 0xFF;
+}
+
+static void set_line(uint32_t in[4], uint32_t irq, int level)
+{
+    if (level)
+        in[irq >> 5] |= 1u << (irq & 31);
+}
+
+/* interrupt inputs, from the peripheral models and ISR_SET */
+static void aintc_inputs(uint32_t in[4])
+{
+    for (int n = 0; n < 4; n++)
+        in[n] = aintc.isr_sw[n];
+    set_line(in, 72, uart_irq_level());
+    for (int i = 0; i < GPIO_NR_BANKS; i++) {
+        set_line(in, gpio_hw[i].irq_a, gpio_line(&gpio[i], 0));
+        set_line(in, gpio_hw[i].irq_b, gpio_line(&gpio[i], 1));
+    }
+    for (int i = 0; i < TIMER_NR; i++)
+        set_line(in, timer_hw[i].irq, timer_irq_level(&timers[i]));
+}
+
+static int aintc_pending(const uint32_t in[4], uint32_t irq)
+{
+    return (in[irq >> 5] & ~aintc.mir[irq >> 5] & (1u << (irq & 31))) &&
+           !(aintc.ilr[irq] & 1);                       /* FIQ lines not modelled */
+}
+
+/*
+ * Priority sorting: the pending, unmasked IRQ with the lowest priority value
+ * below THRESHOLD (ties: the higher line number) gets latched into SIR_IRQ
+ * and drives the CPU IRQ input until NEWIRQAGR. A latched source that goes
+ * away drops the IRQ and sorting starts over.
+ */
+static void aintc_update(void)
+{
+    uint32_t in[4];
+    uint32_t best = AINTC_NR_IRQS, best_prio = 0;
+
+    aintc_inputs(in);
+    if (aintc.latched) {
+        if (aintc_pending(in, aintc.sir))
+            return;
+        aintc.latched = 0;
+    }
+    for (uint32_t irq = 0; irq < AINTC_NR_IRQS; irq++) {
+        uint32_t prio;
+
+        if (!(in[irq >> 5] & ~aintc.mir[irq >> 5]))
+            irq |= 31;                                  /* nothing in this bank */
+        else if (aintc_pending(in, irq)) {
+            prio = (aintc.ilr[irq] >> 2) & 0x3F;
+            if (prio < aintc.threshold && (best == AINTC_NR_IRQS || prio <= best_prio)) {
+                best = irq;
+                best_prio = prio;
+            }
+        }
+    }
+    if (best == AINTC_NR_IRQS)
+        return;
+    aintc.latched = 1;
+    aintc.sir = best;
+    aintc.prio = best_prio;
+}
+
+static int aintc_irq_level(void)
+{
+    aintc_update();
+    return aintc.latched;
+}
+
+static int aintc_read(uint32_t off, uint32_t *val)
+{
+    uint32_t n = (off - 0x80) >> 5, in[4];
+
+    if (off >= 0x100 && off < 0x100 + 4 * AINTC_NR_IRQS) {
+        *val = aintc.ilr[(off - 0x100) >> 2];
+        return 1;
+    }
+    if (off >= 0x80 && off < 0x100) {
+        aintc_inputs(in);
+        switch ((off - 0x80) & 0x1F) {
+        case 0x00: *val = in[n]; return 1;                              /* ITR */
+        case 0x04: *val = aintc.mir[n]; return 1;
+        case 0x10: *val = aintc.isr_sw[n]; return 1;
+        case 0x18: *val = in[n] & ~aintc.mir[n]; return 1;              /* PENDING_IRQ */
+        case 0x1C: *val = 0; return 1;                                  /* PENDING_FIQ */
+        }
+        return 0;
+    }
+    switch (off) {
+    case 0x10: *val = aintc.sysconfig; return 1;
+    case 0x14: *val = 1; return 1;                      /* SYSSTATUS: reset done */
+    case 0x40:
+        aintc_update();
+        *val = aintc.latched ? aintc.sir : (SIR_SPURIOUS | aintc.sir);
+        return 1;
+    case 0x44: *val = SIR_SPURIOUS; return 1;           /* SIR_FIQ */
+    case 0x4C: *val = aintc.protection; return 1;
+    case 0x50: *val = aintc.idle; return 1;
+    case 0x60:
+        aintc_update();
+        *val = aintc.latched ? aintc.prio : (SIR_SPURIOUS | aintc.prio);
+        return 1;
+    case 0x64: *val = SIR_SPURIOUS; return 1;
+    case 0x68: *val = aintc.threshold; return 1;
+    }
+    return 0;
+}
+
+static int aintc_write(uint32_t off, uint32_t val)
+{
+    uint32_t n = (off - 0x80) >> 5;
+
+    if (off >= 0x100 && off < 0x100 + 4 * AINTC_NR_IRQS) {
+        aintc.ilr[(off - 0x100) >> 2] = val & 0xFD;
+        return 1;
+    }
+    if (off >= 0x80 && off < 0x100) {
+        switch ((off - 0x80) & 0x1F) {
+        case 0x04: aintc.mir[n] = val; return 1;
+        case 0x08: aintc.mir[n] &= ~val; return 1;                      /* MIR_CLEAR */
+        case 0x0C: aintc.mir[n] |= val; return 1;                       /* MIR_SET */
+        case 0x10: aintc.isr_sw[n] |= val; return 1;                    /* ISR_SET */
+        case 0x14: aintc.isr_sw[n] &= ~val; return 1;                   /* ISR_CLEAR */
+        }
+        return 1;                                       /* read-only ones */
+    }
+    switch (off) {
+    case 0x10:
+        if (val & (1u << 1))
+            aintc_reset();
+        aintc.sysconfig = val & ~(1u << 1);
+        return 1;
+    case 0x48:
+        if (val & 1)
+            aintc.latched = 0;                          /* NEWIRQAGR */
+        return 1;
+    case 0x4C: aintc.protection = val; return 1;
+    case 0x50: aintc.idle = val; return 1;
+    case 0x68: aintc.threshold = val & 0xFF; return 1;
+    }
+    return 0;
+}
+
+/* ---------------- driver callbacks ---------------- */
+
+#define SIM_NR_CALLBACKS 16
+
+static struct {
+    uint64_t ns;
+    void (*fn)(void *ctx);
+    void *ctx;
+} callbacks[SIM_NR_CALLBACKS];
+static int nr_callbacks;
+
+int sim_at(uint64_t ns, void (*fn)(void *ctx), void *ctx)
+{
+    int i;
+
+    if (nr_callbacks == SIM_NR_CALLBACKS)
+        return -1;
+    /* kept sorted, soonest last */
+    for (i = nr_callbacks; i > 0 && callbacks[i - 1].ns < ns; i--)
+        callbacks[i] = callbacks[i - 1];
+    callbacks[i].ns = ns;
+    callbacks[i].fn = fn;
+    callbacks[i].ctx = ctx;
+    nr_callbacks++;
+    next_due = 0;
+    return 0;
+}
+
+static void callbacks_run(void)
+{
+    while (nr_callbacks && callbacks[nr_callbacks - 1].ns <= now_ns) {
+        nr_callbacks--;
+        callbacks[nr_callbacks].fn(callbacks[nr_callbacks].ctx);
+    }
+}
+
+/* reset state of the models that don't start out all zeroes */
+static void sim_init(void)
+{
+    static int done;
+
+    if (done)
+        return;
+    done = 1;
+    aintc_reset();
+    for (int i = 0; i < GPIO_NR_BANKS; i++)
+        gpio_reset(&gpio[i]);
+    for (int i = 0; i < TIMER_NR; i++)
+        timer_rebase(&timers[i], 0, 0);
+}
+
+/* ---------------- CPU: time and interrupts ---------------- */
+
+static void (*irq_vector)(void);
+static int cpu_irq_on;
+static int irq_depth;
+static int in_update;
+
+static uint64_t next_event_ns(void);
+
+/* CCNT polling loops land here millions of times: skip it until something is due */
+static void update_all(void)
+{
+    sim_init();
+    if (in_update || now_ns < next_due)
+        return;
+    in_update = 1;
+    uart_update();
+    for (int i = 0; i < TIMER_NR; i++)
+        timer_update(&timers[i]);
+    callbacks_run();
+    next_due = next_event_ns();
+    in_update = 0;
+}
+
+static int irq_level(void)
+{
+    sim_init();
+    return aintc_irq_level();
+}
+
+const void *sim_vbar;
+
+static uint64_t next_event_ns(void)
+{
+    uint64_t next = uart.shifting ? uart.shift_done_ns : UINT64_MAX;
+    uint64_t t = timers_next_ns();
+
+    if (t < next)
+        next = t;
+    if (nr_callbacks && callbacks[nr_callbacks - 1].ns < next)
+        next = callbacks[nr_callbacks - 1].ns;
+    return next;
+}
+
+/*
+ * between two accesses: take the IRQ exception if one is due. The handler
+ * runs with the I bit set, restored on return; a handler that clears it
+ * can be interrupted in turn (nesting).
+ */
+static void maybe_take_irq(void)
+{
+    while (irq_vector && cpu_irq_on && irq_level()) {
+        uint64_t t0 = now_ns;
+
+        cpu_irq_on = 0;
+        irq_depth++;
+        irq_vector();
+        irq_depth--;
+        cpu_irq_on = 1;
+        sim_stats.irqs++;
+        if (!irq_depth)
+            sim_stats.irq_ns += now_ns - t0;
+    }
+}
+
+static void tick(void)
+{
+    now_ns += sim_access_ns;
+    update_all();
+}
+
+static int model_read(uint32_t addr, uint32_t *val)
+{
+    struct gpio_bank *g;
+    int t;
+
+    if (addr - AINTC_BASE < 0x1000)
+        return aintc_read(addr - AINTC_BASE, val);
+    if (addr - UART0_BASE < 0x1000)
+        return uart_read(addr - UART0_BASE, val);
+    if ((g = gpio_find(addr)))
+        return gpio_read(g, addr & 0xFFF, val);
+    if ((t = timer_find(addr)) >= 0)
+        return timer_read(t, addr & 0xFFF, val);
+    if (addr - WDT1_BASE < 0x1000)
+        return wdt_read(addr - WDT1_BASE, val);
+    return 0;
+}
+
+static int model_write(uint32_t addr, uint32_t val)
+{
+    struct gpio_bank *g;
+    int t;
+
+    if (addr - AINTC_BASE < 0x1000)
+        return aintc_write(addr - AINTC_BASE, val);
+    if (addr - UART0_BASE < 0x1000)
+        return uart_write(addr - UART0_BASE, val);
+    if ((g = gpio_find(addr)))
+        return gpio_write(g, addr & 0xFFF, val);
+    if ((t = timer_find(addr)) >= 0)
+        return timer_write(t, addr & 0xFFF, val);
+    if (addr - WDT1_BASE < 0x1000)
+        return wdt_write(addr - WDT1_BASE, val);
+    return 0;
+}
+
+uint32_t sim_read(uint32_t addr)
+{
+    uint32_t val;
+
+    sim_stats.reads++;
+    tick();
+    if (!model_read(addr, &val))
+        val = *regfile_slot(addr);
+    next_due = 0;               /* the access may change what's due next */
+    maybe_take_irq();
+    return val;
+}
+
+void sim_write(uint32_t addr, uint32_t val)
+{
+    sim_stats.writes++;
+    tick();
+    if (!model_write(addr, val))
+        *regfile_slot(addr) = val;
+    next_due = 0;
+    maybe_take_irq();
+}
+
+uint64_t sim_cycles_ns(void)
+{
+    now_ns += sim_cp15_ns;
+    /* no access, no model event: no IRQ can have become pending either */
+    if (now_ns < next_due)
+        return now_ns;
+    update_all();
+    maybe_take_irq();
+    return now_ns;
+}
+
+uint64_t sim_now_ns(void)
+{
+    return now_ns;
+}
+
+void sim_advance_ns(uint64_t ns)
+{
+    uint64_t end = now_ns + ns;
+
+    while (now_ns < end) {
+        uint64_t next = next_event_ns();
+
+        now_ns = next < end ? next : end;
+        update_all();
+        maybe_take_irq();
+    }
+}
+
+/* wakes on a pending IRQ even with the I bit set, like the real one */
+void sim_wfi(void)
+{
+    uint64_t t0 = now_ns;
+
+    while (!irq_level()) {
+        uint64_t next = next_event_ns();
+
+        if (next == UINT64_MAX) {
+            fprintf(stderr, "sim: WFI with no event pending, the CPU would sleep forever\n");
+            exit(1);
+        }
+        now_ns = next;
+        update_all();
+    }
+    sim_stats.wfi_ns += now_ns - t0;
+    maybe_take_irq();
+}
+
+void sim_set_irq_vector(void (*fn)(void))
+{
+    irq_vector = fn;
+}
+
+void sim_cpu_irq_enable(int on)
+{
+    cpu_irq_on = on;
+    if (on)
+        maybe_take_irq();
+}
+
+int sim_cpu_irq_enabled(void)
+{
+    return cpu_irq_on;
+}
+
+/* ---------------- driver ---------------- */
+
+static jmp_buf stop_jmp;
+static int running;
+
+/* the firmware is plain C: nothing to unwind when sim_stop() jumps out */
+int sim_run(int (*fn)(void))
+{
+    int ret = 0;
+
+    sim_init();
+    running = 1;
+    if (!setjmp(stop_jmp))
+        ret = fn();
+    running = 0;
+    in_update = 0;
+    irq_depth = 0;
+    cpu_irq_on = 0;
+    return ret;
+}
+
+void sim_stop(void)
+{
+    if (!running) {
+        fprintf(stderr, "sim: sim_stop() outside sim_run()\n");
+        exit(1);
+    }
+    longjmp(stop_jmp, 1);
+}
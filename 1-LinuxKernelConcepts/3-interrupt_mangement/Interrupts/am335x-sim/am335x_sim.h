@@ -0,0 +1,88 @@
+#ifndef AM335X_SIM_H
+#define AM335X_SIM_H
+
+/*
+ * Host-side model of the AM335x peripherals the bare-metal firmwares use.
+ *
+ * The firmware sources are built for the host unchanged: compiled as C++
+ * with this header forced in front of them (-include am335x_sim.h). REG32()
+ * then yields a small proxy object instead of a volatile pointer: reading it
+ * calls sim_read(), assigning to it calls sim_write(). The model needs to
+ * know reads from writes - a write of 0x2 to a write-1-to-clear status that
+ * holds 0x2 looks like nothing happened in plain memory.
+ *
+ * Time is simulated. Every register access takes sim_access_ns, a CCNT
+ * read sim_cp15_ns, WFI jumps to the next peripheral event, and interrupts
+ * are taken between two accesses, like a CPU would between two
+ * instructions. Interrupts reach the CPU through the AINTC model, so the
+ * firmware's own mask/priority/NEWIRQAGR handling is what gets exercised.
+ *
+ * A host driver runs the firmware (sim_run), injects inputs from callbacks
+ * at simulated times (sim_at) and stops it (sim_stop).
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct sim_stats {
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t irqs;          /* IRQ exceptions taken */
+    uint64_t irq_ns;        /* simulated time spent in them */
+    uint64_t wfi_ns;        /* simulated time asleep in WFI */
+};
+
+extern struct sim_stats sim_stats;
+extern uint32_t sim_access_ns;  /* cost of one register access */
+extern uint32_t sim_cp15_ns;    /* cost of a CCNT read */
+
+uint32_t sim_read(uint32_t addr);
+void sim_write(uint32_t addr, uint32_t val);
+
+uint64_t sim_now_ns(void);
+void sim_advance_ns(uint64_t ns);
+void sim_wfi(void);
+/* CCNT read: time advances a little, an IRQ may be taken */
+uint64_t sim_cycles_ns(void);
+
+/* the CPU: IRQ exception entry (I bit set while in it), and the CPSR I bit */
+void sim_set_irq_vector(void (*fn)(void));
+void sim_cpu_irq_enable(int on);
+int sim_cpu_irq_enabled(void);
+extern const void *sim_vbar;    /* VBAR, only kept for the firmware to read back */
+
+/* driver: run fn until it returns or sim_stop(); callbacks at simulated times */
+int sim_run(int (*fn)(void));
+void sim_stop(void);
+int sim_at(uint64_t ns, void (*fn)(void *ctx), void *ctx);
+
+/* GPIO banks 0-3: external pin levels in (edges as configured), DATAOUT out */
+void sim_gpio_set(uint32_t bank, uint32_t pin, int level);
+uint32_t sim_gpio_out(uint32_t bank);
+
+/* WDT1: still armed (the WSPR 0xAAAA/0x5555 disable sequence not seen) */
+int sim_wdt_running(void);
+
+/* UART0: bytes leave at the programmed baud rate */
+void sim_uart_set_tx_hook(void (*fn)(char c));
+uint32_t sim_uart_overruns(void);   /* THR writes into a full FIFO */
+
+#ifdef __cplusplus
+}
+
+struct sim_reg {
+    uint32_t addr;
+
+    operator uint32_t() const { return sim_read(addr); }
+    const sim_reg &operator=(uint32_t v) const { sim_write(addr, v); return *this; }
+    const sim_reg &operator|=(uint32_t v) const { sim_write(addr, sim_read(addr) | v); return *this; }
+    const sim_reg &operator&=(uint32_t v) const { sim_write(addr, sim_read(addr) & v); return *this; }
+};
+
+#define REG32(a)    (sim_reg{ (uint32_t)(a) })
+#define cpu_wfi()   sim_wfi()
+#endif
+
+#endif /* AM335X_SIM_H */
@@ -0,0 +1,283 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/timekeeping.h>
+#include <linux/sched/clock.h>
+#include <linux/timex.h>
+#include <linux/math64.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/workqueue.h>
+#include <linux/slab.h>
+#include <linux/cpumask.h>
+
+/*
+ * What does a timestamp cost, and can two of them be compared?
+ *
+ * For every clock below, on every online CPU (work_on_cpu()):
+ *   - ns per call, over calls_per_cpu back-to-back calls, minus the cost
+ *     of calling an empty function the same way
+ *   - how often a read was smaller than the previous one on the same CPU
+ *
+ * and between CPU 0 and every other CPU: two pinned kthreads pass a token
+ * back and forth, each reads the clock when it gets the token and checks
+ * it is not behind the value the other CPU read just before. A clock that
+ * goes backwards there cannot order events that happen on different CPUs.
+ */
+
+static unsigned int calls_per_cpu = 100000;
+module_param(calls_per_cpu, uint, 0444);
+MODULE_PARM_DESC(calls_per_cpu, "Back-to-back reads per clock and CPU");
+
+static unsigned int handoffs = 100000;
+module_param(handoffs, uint, 0444);
+MODULE_PARM_DESC(handoffs, "Token passes per clock and CPU pair (0 = skip the cross-CPU check)");
+
+static u64 read_none(void)
+{
+	return 0;
+}
+
+static u64 read_jiffies(void)
+{
+	return get_jiffies_64();
+}
+
+static u64 read_ktime_get(void)
+{
+	return ktime_to_ns(ktime_get());
+}
+
+static u64 read_ktime_get_real_ts64(void)
+{
+	struct timespec64 ts;
+
+	ktime_get_real_ts64(&ts);
+	return timespec64_to_ns(&ts);
+}
+
+static u64 read_get_cycles(void)
+{
+	return (u64)get_cycles();
+}
+
+struct clock_desc {
+	const char *name;
+	u64 (*read)(void);
+};
+
+/* index 0 is the call overhead the others are corrected by */
+static const struct clock_desc clocks[] = {
+	{ "(empty call)",           read_none },
+	{ "jiffies_64",             read_jiffies },
+	{ "ktime_get",              read_ktime_get },
+	{ "ktime_get_ns",           ktime_get_ns },
+	{ "ktime_get_coarse_ns",    ktime_get_coarse_ns },
+	{ "ktime_get_mono_fast_ns", ktime_get_mono_fast_ns },
+	{ "ktime_get_raw_ns",       ktime_get_raw_ns },
+	{ "ktime_get_real_ts64",    read_ktime_get_real_ts64 },
+	{ "local_clock",            local_clock },
+	{ "sched_clock",            sched_clock },
+	{ "get_cycles",             read_get_cycles },
+};
+
+#define NR_CLOCKS ARRAY_SIZE(clocks)
+
+struct cpu_result {
+	u64 ns;                 /* for calls_per_cpu reads */
+	u64 backwards;
+	bool all_zero;
+};
+
+static struct cpu_result *results;     /* [cpu][clock] */
+
+static long measure_on_cpu(void *arg)
+{
+	struct cpu_result *res = arg;
+	unsigned int c, i;
+
+	for (c = 0; c < NR_CLOCKS; c++) {
+		u64 (*read)(void) = clocks[c].read;
+		u64 prev, t0, v, or = 0;
+
+		prev = read();
+		t0 = ktime_get_ns();
+		for (i = 0; i < calls_per_cpu; i++) {
+			v = read();
+			if (v < prev)
+				res[c].backwards++;
+			or |= v;
+			prev = v;
+		}
+		res[c].ns = ktime_get_ns() - t0;
+		res[c].all_zero = !or;
+		cond_resched();
+	}
+	return 0;
+}
+
+struct xcheck {
+	u64 (*read)(void);
+	atomic_t seq;           /* even: CPU 0's turn, odd: the other's */
+	u64 last;               /* value read by the token holder */
+	u64 backwards;
+	u64 max_back;
+	bool aborted;
+	struct completion done;
+};
+
+struct xside {
+	struct xcheck *x;
+	unsigned int parity;
+};
+
+static int xcheck_fn(void *arg)
+{
+	struct xside *side = arg;
+	struct xcheck *x = side->x;
+	unsigned int i;
+
+	for (i = 0; i < handoffs && !READ_ONCE(x->aborted); i++) {
+		unsigned int want = 2 * i + side->parity;
+		unsigned long deadline = jiffies + HZ;
+		u64 t;
+
+		while (atomic_read_acquire(&x->seq) != want) {
+			if (READ_ONCE(x->aborted) || time_after(jiffies, deadline)) {
+				WRITE_ONCE(x->aborted, true);
+				goto out;
+			}
+			cpu_relax();
+		}
+
+		/* we hold the token: the other side waits */
+		t = x->read();
+		if (t < x->last) {
+			x->backwards++;
+			x->max_back = max(x->max_back, x->last - t);
+		}
+		x->last = t;
+		atomic_set_release(&x->seq, want + 1);
+	}
+out:
+	kthread_complete_and_exit(&x->done, 0);
+}
+
+static int cross_check(const struct clock_desc *clk, int cpu, struct xcheck *x)
+{
+	struct xside sides[2] = { { x, 0 }, { x, 1 } };
+	int cpus[2] = { 0, cpu };
+	int s, started = 0;
+
+	memset(x, 0, sizeof(*x));
+	x->read = clk->read;
+	x->last = clk->read();
+	init_completion(&x->done);
+
+	for (s = 0; s < 2; s++) {
+		struct task_struct *t = kthread_create(xcheck_fn, &sides[s], "clk_x/%d", cpus[s]);
+
+		if (IS_ERR(t)) {
+			WRITE_ONCE(x->aborted, true);
+			break;
+		}
+		kthread_bind(t, cpus[s]);
+		wake_up_process(t);
+		started++;
+	}
+	/* sides[] lives on our stack: wait for both before returning */
+	for (s = 0; s < started; s++)
+		wait_for_completion(&x->done);
+
+	return x->aborted ? -ETIMEDOUT : 0;
+}
+
+static void report(unsigned int c, struct xcheck *x)
+{
+	u64 best = U64_MAX, worst = 0, backwards = 0;
+	int cpu, best_cpu = 0, worst_cpu = 0;
+	u32 best_rem, worst_rem;
+	bool zero = true;
+
+	for_each_online_cpu(cpu) {
+		struct cpu_result *r = &results[cpu * NR_CLOCKS + c];
+		u64 base = c ? results[cpu * NR_CLOCKS].ns : 0;
+		/* tenths of ns per call, empty call subtracted */
+		u64 x10 = div_u64((r->ns > base ? r->ns - base : 0) * 10, calls_per_cpu);
+
+		if (x10 < best) {
+			best = x10;
+			best_cpu = cpu;
+		}
+		if (x10 >= worst) {
+			worst = x10;
+			worst_cpu = cpu;
+		}
+		backwards += r->backwards;
+		zero &= r->all_zero;
+	}
+
+	pr_info("%-22s %4llu.%u ns/call (cpu%d) .. %4llu.%u (cpu%d), same-CPU backwards %llu%s\n",
+		clocks[c].name, div_u64_rem(best, 10, &best_rem), best_rem, best_cpu,
+		div_u64_rem(worst, 10, &worst_rem), worst_rem, worst_cpu, backwards,
+		zero && c ? ", always 0 on this platform" : "");
+
+	if (!c || zero || !handoffs)
+		return;
+	for_each_online_cpu(cpu) {
+		if (!cpu)
+			continue;
+		if (cross_check(&clocks[c], cpu, x))
+			pr_info("%-22s   cpu0<->cpu%d: timed out\n", clocks[c].name, cpu);
+		else
+			pr_info("%-22s   cpu0<->cpu%d: %llu of %u handoffs went backwards, max %llu\n",
+				clocks[c].name, cpu, x->backwards, 2 * handoffs, x->max_back);
+	}
+}
+
+static int __init clock_cost_init(void)
+{
+	struct xcheck *x;
+	unsigned int c;
+	int cpu;
+
+	if (!calls_per_cpu)
+		return -EINVAL;
+
+	results = kcalloc(nr_cpu_ids * NR_CLOCKS, sizeof(*results), GFP_KERNEL);
+	x = kzalloc(sizeof(*x), GFP_KERNEL);
+	if (!results || !x) {
+		kfree(results);
+		kfree(x);
+		return -ENOMEM;
+	}
+
+	cpus_read_lock();
+	for_each_online_cpu(cpu)
+		work_on_cpu(cpu, measure_on_cpu, &results[cpu * NR_CLOCKS]);
+
+	pr_info("%u calls per clock and CPU, %u CPUs, %u handoffs per CPU pair\n",
+		calls_per_cpu, num_online_cpus(), 2 * handoffs);
+	for (c = 0; c < NR_CLOCKS; c++)
+		report(c, x);
+	cpus_read_unlock();
+
+	kfree(x);
+	kfree(results);
+	return 0;
+}
+
+static void __exit clock_cost_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(clock_cost_init);
+module_exit(clock_cost_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Per-call cost and cross-CPU monotonicity of the kernel clocks");
@@ -0,0 +1,162 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/delay.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+
+/*
+ * udelay_ex.c calls udelay() once. This asks every delay primitive for the
+ * same durations many times and looks at what actually elapsed:
+ *
+ *   ndelay        busy wait, ns argument
+ *   udelay        busy wait, us argument (rounded up)
+ *   usleep_range  hrtimer sleep in [us, us + range_pct%]
+ *   fsleep        picks udelay / usleep_range / msleep for the duration
+ *
+ * Each call is timed with ktime_get_ns() and with local_clock(), so a
+ * suspicious number can be checked against a second clock. Busy waits are
+ * capped at max_busy_ns to not burn seconds of CPU.
+ */
+
+static ulong durations_ns[16] = {
+	500, 1000, 2000, 5000, 10000, 20000, 50000, 100000,
+	200000, 500000, 1000000, 10000000,
+};
+static int nr_durations = 12;
+module_param_array(durations_ns, ulong, &nr_durations, 0444);
+MODULE_PARM_DESC(durations_ns, "Requested delays in ns, comma separated (up to 16)");
+
+static unsigned int samples = 200;
+module_param(samples, uint, 0444);
+MODULE_PARM_DESC(samples, "Calls per primitive and duration");
+
+static unsigned int range_pct = 20;
+module_param(range_pct, uint, 0444);
+MODULE_PARM_DESC(range_pct, "usleep_range() upper bound, percent above the request");
+
+static ulong max_busy_ns = 1000000;
+module_param(max_busy_ns, ulong, 0444);
+MODULE_PARM_DESC(max_busy_ns, "Longest duration tried with the busy-wait primitives");
+
+enum prim { P_NDELAY, P_UDELAY, P_USLEEP_RANGE, P_FSLEEP, NR_PRIMS };
+
+static const char * const prim_names[NR_PRIMS] = {
+	"ndelay", "udelay", "usleep_range", "fsleep",
+};
+
+static void do_delay(enum prim p, unsigned long ns)
+{
+	unsigned long us = DIV_ROUND_UP(ns, NSEC_PER_USEC);
+
+	switch (p) {
+	case P_NDELAY:
+		ndelay(ns);
+		break;
+	case P_UDELAY:
+		udelay(us);
+		break;
+	case P_USLEEP_RANGE:
+		usleep_range(us, us + us * range_pct / 100);
+		break;
+	default:
+		fsleep(us);
+		break;
+	}
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void measure(enum prim p, unsigned long req, u64 *elapsed)
+{
+	u64 sum = 0, sum_local = 0, cpu_ns, wall_ns, t_start, cpu_start;
+	unsigned int i, shorter = 0, cpu_pct;
+	s64 err, err_pm;
+	u64 err_whole;
+	u32 err_frac;
+
+	/* a sleep updates sum_exec_runtime when we are switched out */
+	cpu_start = current->se.sum_exec_runtime;
+	t_start = ktime_get_ns();
+	for (i = 0; i < samples; i++) {
+		u64 t0 = ktime_get_ns(), l0 = local_clock();
+
+		do_delay(p, req);
+		elapsed[i] = ktime_get_ns() - t0;
+		sum_local += local_clock() - l0;
+		sum += elapsed[i];
+		shorter += elapsed[i] < req;
+	}
+	wall_ns = ktime_get_ns() - t_start;
+
+	/* a busy wait burns what it waits; no context switch to account it */
+	if (p == P_NDELAY || p == P_UDELAY)
+		cpu_ns = wall_ns;
+	else
+		cpu_ns = current->se.sum_exec_runtime - cpu_start;
+	cpu_pct = wall_ns ? div64_u64(cpu_ns * 100, wall_ns) : 0;
+
+	sort(elapsed, samples, sizeof(*elapsed), cmp_u64, NULL);
+	err = div_u64(sum, samples) - req;
+	err_pm = div64_s64(err * 1000, req);
+	err_whole = div_u64_rem(abs(err_pm), 10, &err_frac);
+
+	pr_info("%-12s %8lu ns: avg %llu min %llu p50 %llu p99 %llu max %llu ns, err %+lld ns (%c%llu.%u%%), %u short, local_clock avg %llu ns, cpu %llu ns/call (%u%%)\n",
+		prim_names[p], req, div_u64(sum, samples), elapsed[0],
+		elapsed[samples / 2], elapsed[samples - 1 - samples / 100], elapsed[samples - 1],
+		err, err_pm < 0 ? '-' : '+', err_whole, err_frac,
+		shorter, div_u64(sum_local, samples), div_u64(cpu_ns, samples), cpu_pct);
+}
+
+static int __init delay_accuracy_init(void)
+{
+	u64 *elapsed;
+	int d, p;
+
+	if (!samples || !nr_durations)
+		return -EINVAL;
+
+	elapsed = kmalloc_array(samples, sizeof(*elapsed), GFP_KERNEL);
+	if (!elapsed)
+		return -ENOMEM;
+
+	pr_info("HZ=%d loops_per_jiffy=%lu (%lu.%02lu BogoMIPS), %u samples\n",
+		HZ, loops_per_jiffy, loops_per_jiffy / (500000 / HZ),
+		(loops_per_jiffy / (5000 / HZ)) % 100, samples);
+
+	for (d = 0; d < nr_durations; d++) {
+		unsigned long req = durations_ns[d];
+
+		if (!req)
+			continue;
+		for (p = 0; p < NR_PRIMS; p++) {
+			if ((p == P_NDELAY || p == P_UDELAY) && req > max_busy_ns)
+				continue;
+			measure(p, req, elapsed);
+		}
+	}
+
+	kfree(elapsed);
+	return 0;
+}
+
+static void __exit delay_accuracy_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(delay_accuracy_init);
+module_exit(delay_accuracy_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Accuracy and CPU cost of ndelay, udelay, usleep_range and fsleep");
@@ -0,0 +1,239 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/timer.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
+#include <linux/vmalloc.h>
+#include <linux/delay.h>
+#include <linux/percpu.h>
+#include <linux/kernel_stat.h>
+#include <linux/interrupt.h>
+#include <linux/sched.h>
+
+/*
+ * timer_example.c arms one timer_list. This arms nr_timers of them with
+ * random expiries, the way connection tracking keeps one timeout per flow:
+ *
+ *   1. arm     mod_timer() on every (idle) timer
+ *   2. refresh mod_timer() on mod_pct% of them while pending (moves them
+ *              to another wheel bucket)
+ *   3. cancel  del_timer() on cancel_pct% of them
+ *   4. expire  every callback re-arms itself rearm_rounds times
+ *
+ * and reports ns per arm/refresh/cancel, expiry lateness in jiffies, and
+ * the softirq time the whole run consumed. The run happens in module init;
+ * insmod returns when it is done.
+ */
+
+static unsigned int nr_timers = 10000;
+module_param(nr_timers, uint, 0444);
+MODULE_PARM_DESC(nr_timers, "Number of timer_list timers (1000 - 1000000)");
+
+static unsigned int max_expiry_ms = 1000;
+module_param(max_expiry_ms, uint, 0444);
+MODULE_PARM_DESC(max_expiry_ms, "Expiries are uniform in [1 jiffy, max_expiry_ms]");
+
+static unsigned int mod_pct = 50;
+module_param(mod_pct, uint, 0444);
+MODULE_PARM_DESC(mod_pct, "Percent of pending timers pushed out again with mod_timer");
+
+static unsigned int cancel_pct = 10;
+module_param(cancel_pct, uint, 0444);
+MODULE_PARM_DESC(cancel_pct, "Percent of timers cancelled with del_timer before they fire");
+
+static unsigned int rearm_rounds = 1;
+module_param(rearm_rounds, uint, 0444);
+MODULE_PARM_DESC(rearm_rounds, "Times each timer re-arms itself from its callback");
+
+#define LATE_BUCKETS 16         /* 0, 1, 2-3, 4-7, ... jiffies */
+
+struct bench_timer {
+	struct timer_list timer;
+	unsigned int rearms_left;
+};
+
+/* written from the callbacks, so per CPU: no shared cache line in softirq */
+struct bench_cpu_stats {
+	u64 fired;
+	u64 raced;              /* refreshed while its callback was running */
+	u64 late_max;
+	u64 late_sum;
+	u64 late_hist[LATE_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct bench_cpu_stats, cpu_stats);
+static struct bench_timer *timers;
+static unsigned long max_expiry_j;
+
+static unsigned long random_expiry(void)
+{
+	return jiffies + 1 + get_random_u32_below(max_expiry_j);
+}
+
+static void bench_timer_fn(struct timer_list *t)
+{
+	struct bench_timer *bt = from_timer(bt, t, timer);
+	struct bench_cpu_stats *st = this_cpu_ptr(&cpu_stats);
+	long late = (long)(jiffies - t->expires);
+
+	st->fired++;
+	if (late < 0) {
+		st->raced++;
+	} else {
+		st->late_sum += late;
+		if (late > st->late_max)
+			st->late_max = late;
+		st->late_hist[min_t(unsigned int, fls_long(late), LATE_BUCKETS - 1)]++;
+	}
+
+	if (bt->rearms_left) {
+		bt->rearms_left--;
+		mod_timer(t, random_expiry());
+	}
+}
+
+static u64 softirq_time_ns(void)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += kcpustat_cpu(cpu).cpustat[CPUTIME_SOFTIRQ];
+	return sum;
+}
+
+static u64 timer_softirqs(void)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		sum += kstat_softirqs_cpu(TIMER_SOFTIRQ, cpu);
+	return sum;
+}
+
+static void report(u64 arm_ns, u64 mod_ns, unsigned int mods, u64 del_ns,
+		   unsigned int dels, unsigned int cancelled, unsigned int stragglers,
+		   u64 softirq_ns, u64 softirqs, u64 wall_ns)
+{
+	struct bench_cpu_stats tot = {};
+	int cpu, b;
+
+	for_each_possible_cpu(cpu) {
+		struct bench_cpu_stats *st = per_cpu_ptr(&cpu_stats, cpu);
+
+		tot.fired += st->fired;
+		tot.raced += st->raced;
+		tot.late_sum += st->late_sum;
+		tot.late_max = max(tot.late_max, st->late_max);
+		for (b = 0; b < LATE_BUCKETS; b++)
+			tot.late_hist[b] += st->late_hist[b];
+	}
+
+	pr_info("%u timers, expiry <= %u ms (%lu jiffies, HZ=%d), rearm_rounds=%u\n",
+		nr_timers, max_expiry_ms, max_expiry_j, HZ, rearm_rounds);
+	pr_info("arm:     %llu ns/op\n", div_u64(arm_ns, nr_timers));
+	pr_info("refresh: %llu ns/op (%u mod_timer on pending timers)\n",
+		mods ? div_u64(mod_ns, mods) : 0, mods);
+	pr_info("cancel:  %llu ns/op (%u del_timer, %u were pending)\n",
+		dels ? div_u64(del_ns, dels) : 0, dels, cancelled);
+	pr_info("expired: %llu callbacks, %llu raced with a refresh, %u still pending at the end\n",
+		tot.fired, tot.raced, stragglers);
+	pr_info("lateness: avg %llu max %llu jiffies\n",
+		tot.fired > tot.raced ? div64_u64(tot.late_sum, tot.fired - tot.raced) : 0,
+		tot.late_max);
+	for (b = 0; b < LATE_BUCKETS; b++) {
+		if (!tot.late_hist[b])
+			continue;
+		if (b == 0)
+			pr_info("  late 0 jiffies:        %llu\n", tot.late_hist[b]);
+		else
+			pr_info("  late %5lu-%-5lu jiffies: %llu\n",
+				1UL << (b - 1), (1UL << b) - 1, tot.late_hist[b]);
+	}
+	pr_info("softirq: %llu us of softirq time, %llu TIMER_SOFTIRQ runs in %llu ms wall\n",
+		div_u64(softirq_ns, NSEC_PER_USEC), softirqs, div_u64(wall_ns, NSEC_PER_MSEC));
+}
+
+static int __init timer_wheel_bench_init(void)
+{
+	unsigned int i, mods = 0, dels = 0, cancelled = 0, stragglers = 0;
+	u64 t0, arm_ns, mod_ns, del_ns, wall0, softirq0, softirqs0;
+
+	if (nr_timers < 1 || nr_timers > 1000000 || !max_expiry_ms ||
+	    mod_pct > 100 || cancel_pct > 100)
+		return -EINVAL;
+
+	timers = vzalloc(array_size(nr_timers, sizeof(*timers)));
+	if (!timers)
+		return -ENOMEM;
+
+	max_expiry_j = max(msecs_to_jiffies(max_expiry_ms), 1UL);
+	for (i = 0; i < nr_timers; i++) {
+		timer_setup(&timers[i].timer, bench_timer_fn, 0);
+		timers[i].rearms_left = rearm_rounds;
+	}
+
+	wall0 = ktime_get_ns();
+	softirq0 = softirq_time_ns();
+	softirqs0 = timer_softirqs();
+
+	/* 1. arm */
+	t0 = ktime_get_ns();
+	for (i = 0; i < nr_timers; i++)
+		mod_timer(&timers[i].timer, random_expiry());
+	arm_ns = ktime_get_ns() - t0;
+
+	/* 2. refresh a spread of them while they are pending */
+	t0 = ktime_get_ns();
+	for (i = 0; i < nr_timers; i++) {
+		if (i % 100 >= mod_pct)
+			continue;
+		mod_timer(&timers[i].timer, random_expiry());
+		mods++;
+	}
+	mod_ns = ktime_get_ns() - t0;
+
+	/* 3. cancel a different spread (counted from the other end) */
+	t0 = ktime_get_ns();
+	for (i = 0; i < nr_timers; i++) {
+		if ((nr_timers - 1 - i) % 100 >= cancel_pct)
+			continue;
+		timers[i].rearms_left = 0;
+		cancelled += del_timer(&timers[i].timer);
+		dels++;
+	}
+	del_ns = ktime_get_ns() - t0;
+
+	/* 4. let everything expire: first arming + refresh + rearm rounds */
+	msleep(max_expiry_ms * (rearm_rounds + 2) + 100);
+
+	for (i = 0; i < nr_timers; i++) {
+		stragglers += timer_pending(&timers[i].timer);
+		/* also stops a callback that is about to re-arm */
+		timer_shutdown_sync(&timers[i].timer);
+	}
+
+	report(arm_ns, mod_ns, mods, del_ns, dels, cancelled, stragglers,
+	       softirq_time_ns() - softirq0, timer_softirqs() - softirqs0,
+	       ktime_get_ns() - wall0);
+
+	vfree(timers);
+	timers = NULL;
+	return 0;
+}
+
+static void __exit timer_wheel_bench_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(timer_wheel_bench_init);
+module_exit(timer_wheel_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("timer_list arm/refresh/cancel cost and expiry lateness at large timer counts");
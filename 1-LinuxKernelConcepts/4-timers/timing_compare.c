@@ -0,0 +1,373 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/timer.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+#include <linux/kthread.h>
+#include <linux/delay.h>
+#include <linux/completion.h>
+#include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/tick.h>
+#include <linux/cpumask.h>
+
+/*
+ * Drive the same periodic event through each timing primitive in turn and
+ * compare how late it runs and what it costs:
+ *
+ *   timer_list     mod_timer() re-armed from the callback (jiffy resolution)
+ *   hrtimer_soft   HRTIMER_MODE_ABS_SOFT, callback in softirq
+ *   hrtimer_hard   HRTIMER_MODE_ABS_HARD, callback in hardirq
+ *   delayed_work   queue_delayed_work() re-queued from the work function
+ *   kthread        kthread sleeping with usleep_range() between events
+ *
+ * Deadlines are absolute (start + k * period) so lateness does not
+ * accumulate; a deadline already in the past when re-arming is skipped and
+ * counted as an overrun. CPU overhead is the non-idle time of all CPUs
+ * during the run minus an idle baseline measured first.
+ */
+
+static unsigned int period_us = 1000;
+module_param(period_us, uint, 0444);
+MODULE_PARM_DESC(period_us, "Event period in microseconds (100 - 1000000)");
+
+static unsigned int samples = 1000;
+module_param(samples, uint, 0444);
+MODULE_PARM_DESC(samples, "Events per primitive");
+
+static bool sweep;
+module_param(sweep, bool, 0444);
+MODULE_PARM_DESC(sweep, "Run periods 100us, 1ms, 10ms, 100ms, 1s instead of period_us");
+
+static unsigned int max_run_ms = 2000;
+module_param(max_run_ms, uint, 0444);
+MODULE_PARM_DESC(max_run_ms, "Cap on the run time of one primitive; fewer samples at long periods");
+
+static unsigned int slack_us;
+module_param(slack_us, uint, 0444);
+MODULE_PARM_DESC(slack_us, "usleep_range() slack of the kthread method");
+
+static bool verbose;
+module_param(verbose, bool, 0444);
+MODULE_PARM_DESC(verbose, "Print the full lateness histograms");
+
+enum method { M_TIMER, M_HRTIMER_SOFT, M_HRTIMER_HARD, M_DWORK, M_KTHREAD, M_NR };
+
+static const char * const method_names[M_NR] = {
+	"timer_list", "hrtimer_soft", "hrtimer_hard", "delayed_work", "kthread",
+};
+
+#define LAT_BUCKETS 32          /* log2(ns): [2^(b-1), 2^b) */
+
+struct run {
+	enum method method;
+	u64 period_ns;
+	unsigned int samples;
+	unsigned int done;
+	u64 next_ns;            /* deadline of the pending event */
+	u64 overruns;
+	u64 early;
+	u64 lat_sum;
+	u64 lat_max;
+	u64 hist[LAT_BUCKETS];
+	struct completion finished;
+
+	struct timer_list timer;
+	struct hrtimer hrtimer;
+	struct delayed_work dwork;
+	struct task_struct *thread;
+};
+
+static struct run run;
+
+/* account one event; false once the run has all its samples */
+static bool run_record(struct run *r, u64 now)
+{
+	u64 late = 0;
+
+	if (now >= r->next_ns)
+		late = now - r->next_ns;
+	else
+		r->early++;
+
+	r->lat_sum += late;
+	if (late > r->lat_max)
+		r->lat_max = late;
+	r->hist[min_t(unsigned int, fls64(late), LAT_BUCKETS - 1)]++;
+
+	if (++r->done >= r->samples) {
+		complete(&r->finished);
+		return false;
+	}
+
+	r->next_ns += r->period_ns;
+	while (r->next_ns <= now) {
+		r->next_ns += r->period_ns;
+		r->overruns++;
+	}
+	return true;
+}
+
+/* jiffies until the next deadline, rounded up the way a driver would */
+static unsigned long delay_jiffies(struct run *r)
+{
+	u64 now = ktime_get_ns();
+	u64 delta = r->next_ns > now ? r->next_ns - now : 0;
+
+	return max(usecs_to_jiffies(div_u64(delta + NSEC_PER_USEC - 1, NSEC_PER_USEC)), 1UL);
+}
+
+static void run_timer_fn(struct timer_list *t)
+{
+	struct run *r = from_timer(r, t, timer);
+
+	if (run_record(r, ktime_get_ns()))
+		mod_timer(t, jiffies + delay_jiffies(r));
+}
+
+static enum hrtimer_restart run_hrtimer_fn(struct hrtimer *t)
+{
+	struct run *r = container_of(t, struct run, hrtimer);
+
+	if (!run_record(r, ktime_get_ns()))
+		return HRTIMER_NORESTART;
+	hrtimer_set_expires(t, ns_to_ktime(r->next_ns));
+	return HRTIMER_RESTART;
+}
+
+static void run_dwork_fn(struct work_struct *work)
+{
+	struct run *r = container_of(to_delayed_work(work), struct run, dwork);
+
+	if (run_record(r, ktime_get_ns()))
+		queue_delayed_work(system_wq, &r->dwork, delay_jiffies(r));
+}
+
+static int run_thread_fn(void *arg)
+{
+	struct run *r = arg;
+
+	while (!kthread_should_stop()) {
+		u64 now = ktime_get_ns();
+
+		if (now < r->next_ns) {
+			unsigned long us = div_u64(r->next_ns - now, NSEC_PER_USEC);
+
+			usleep_range(us, us + slack_us);
+			now = ktime_get_ns();
+		}
+		if (!run_record(r, now))
+			break;
+	}
+
+	/* kthread_stop() needs us alive until it is called */
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+	return 0;
+}
+
+/* idle time summed over online CPUs, U64_MAX when NO_HZ idle accounting is off */
+static u64 cpu_idle_us(void)
+{
+	u64 sum = 0;
+	int cpu;
+
+	for_each_online_cpu(cpu) {
+		u64 idle = get_cpu_idle_time_us(cpu, NULL);
+
+		if (idle == (u64)-1)
+			return U64_MAX;
+		sum += idle;
+	}
+	return sum;
+}
+
+static u64 quantile(const u64 *hist, u64 total, unsigned int pct)
+{
+	u64 want = div_u64(total * pct, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += hist[b];
+		if (seen > want)
+			return b ? 1ULL << b : 1;
+	}
+	return 1ULL << (LAT_BUCKETS - 1);
+}
+
+static int start_method(struct run *r)
+{
+	switch (r->method) {
+	case M_TIMER:
+		timer_setup(&r->timer, run_timer_fn, 0);
+		mod_timer(&r->timer, jiffies + delay_jiffies(r));
+		break;
+	case M_HRTIMER_SOFT:
+	case M_HRTIMER_HARD: {
+		enum hrtimer_mode mode = r->method == M_HRTIMER_SOFT ?
+			HRTIMER_MODE_ABS_SOFT : HRTIMER_MODE_ABS_HARD;
+
+		hrtimer_init(&r->hrtimer, CLOCK_MONOTONIC, mode);
+		r->hrtimer.function = run_hrtimer_fn;
+		hrtimer_start(&r->hrtimer, ns_to_ktime(r->next_ns), mode);
+		break;
+	}
+	case M_DWORK:
+		INIT_DELAYED_WORK(&r->dwork, run_dwork_fn);
+		queue_delayed_work(system_wq, &r->dwork, delay_jiffies(r));
+		break;
+	case M_KTHREAD:
+		r->thread = kthread_run(run_thread_fn, r, "timing_cmp");
+		if (IS_ERR(r->thread))
+			return PTR_ERR(r->thread);
+		break;
+	default:
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static void stop_method(struct run *r)
+{
+	switch (r->method) {
+	case M_TIMER:
+		timer_shutdown_sync(&r->timer);
+		break;
+	case M_HRTIMER_SOFT:
+	case M_HRTIMER_HARD:
+		hrtimer_cancel(&r->hrtimer);
+		break;
+	case M_DWORK:
+		cancel_delayed_work_sync(&r->dwork);
+		break;
+	case M_KTHREAD:
+		kthread_stop(r->thread);
+		break;
+	default:
+		break;
+	}
+}
+
+static void run_one(enum method method, u64 period_ns, unsigned int nsamples,
+		    u64 idle_busy_per_ms)
+{
+	struct run *r = &run;
+	u64 t0, wall, idle0, idle1, busy = 0, overhead = 0;
+	unsigned long timeout;
+	int b;
+
+	memset(r, 0, sizeof(*r));
+	r->method = method;
+	r->period_ns = period_ns;
+	r->samples = nsamples;
+	init_completion(&r->finished);
+
+	idle0 = cpu_idle_us();
+	t0 = ktime_get_ns();
+	r->next_ns = t0 + period_ns;
+	if (start_method(r)) {
+		pr_err("%s: failed to start\n", method_names[method]);
+		return;
+	}
+
+	timeout = nsecs_to_jiffies(period_ns * nsamples * 2) + HZ;
+	if (!wait_for_completion_timeout(&r->finished, timeout))
+		pr_warn("%s: timed out after %u of %u events\n",
+			method_names[method], r->done, nsamples);
+	stop_method(r);
+
+	wall = ktime_get_ns() - t0;
+	idle1 = cpu_idle_us();
+	if (idle0 != U64_MAX && idle1 != U64_MAX) {
+		u64 idle_ns = (idle1 - idle0) * NSEC_PER_USEC;
+		u64 all_ns = wall * num_online_cpus();
+		u64 baseline = div_u64(wall, NSEC_PER_MSEC) * idle_busy_per_ms;
+
+		busy = all_ns > idle_ns ? all_ns - idle_ns : 0;
+		overhead = busy > baseline ? busy - baseline : 0;
+	}
+
+	pr_info("%-12s period %7llu us: %u events, lateness avg %llu ns p50<%llu p99<%llu max %llu ns, overruns %llu, early %llu\n",
+		method_names[method], div_u64(period_ns, NSEC_PER_USEC), r->done,
+		r->done ? div_u64(r->lat_sum, r->done) : 0,
+		quantile(r->hist, r->done, 50), quantile(r->hist, r->done, 99),
+		r->lat_max, r->overruns, r->early);
+	pr_info("%-12s period %7llu us: cpu %llu us busy in %llu ms, ~%llu ns/event above idle\n",
+		method_names[method], div_u64(period_ns, NSEC_PER_USEC),
+		div_u64(busy, NSEC_PER_USEC), div_u64(wall, NSEC_PER_MSEC),
+		r->done ? div_u64(overhead, r->done) : 0);
+
+	if (!verbose)
+		return;
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		if (r->hist[b])
+			pr_info("  [%10llu, %10llu) ns: %llu\n",
+				b ? 1ULL << (b - 1) : 0, 1ULL << b, r->hist[b]);
+	}
+}
+
+/* busy ns per ms of wall time while this module just sleeps */
+static u64 idle_baseline(void)
+{
+	u64 idle0 = cpu_idle_us(), t0 = ktime_get_ns(), wall, idle_ns, all_ns;
+
+	msleep(500);
+	wall = ktime_get_ns() - t0;
+	if (idle0 == U64_MAX) {
+		pr_info("NO_HZ idle accounting not available, no CPU overhead figures\n");
+		return 0;
+	}
+	idle_ns = (cpu_idle_us() - idle0) * NSEC_PER_USEC;
+	all_ns = wall * num_online_cpus();
+	return all_ns > idle_ns ? div_u64(all_ns - idle_ns, div_u64(wall, NSEC_PER_MSEC)) : 0;
+}
+
+static int __init timing_compare_init(void)
+{
+	static const unsigned int sweep_us[] = { 100, 1000, 10000, 100000, 1000000 };
+	unsigned int np = sweep ? ARRAY_SIZE(sweep_us) : 1;
+	u64 baseline;
+	unsigned int p;
+	int m;
+
+	if (!sweep && (period_us < 100 || period_us > 1000000))
+		return -EINVAL;
+	if (!samples)
+		return -EINVAL;
+
+	baseline = idle_baseline();
+	pr_info("HZ=%d, %u CPUs online, idle baseline %llu ns busy per ms\n",
+		HZ, num_online_cpus(), baseline);
+
+	for (p = 0; p < np; p++) {
+		u64 period_ns = (u64)(sweep ? sweep_us[p] : period_us) * NSEC_PER_USEC;
+		unsigned int n = samples;
+
+		/* keep one run under max_run_ms, but never below 5 events */
+		if (max_run_ms && period_ns * n > (u64)max_run_ms * NSEC_PER_MSEC)
+			n = max_t(unsigned int, div64_u64((u64)max_run_ms * NSEC_PER_MSEC, period_ns), 5);
+
+		for (m = 0; m < M_NR; m++)
+			run_one(m, period_ns, n, baseline);
+	}
+
+	return 0;
+}
+
+static void __exit timing_compare_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(timing_compare_init);
+module_exit(timing_compare_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Lateness and CPU cost of timer_list, hrtimer, delayed_work and usleep_range");
@@ -0,0 +1,297 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/wait.h>
+#include <linux/wait_bit.h>
+#include <linux/completion.h>
+#include <linux/atomic.h>
+#include <linux/cpumask.h>
+#include <linux/ktime.h>
+#include <linux/sched/clock.h>
+
+/*
+ * One-shot "work is ready" handshakes, the kind an IRQ thread and a worker
+ * use, done four ways:
+ *
+ *   waitqueue   flag + wait_event()/wake_up(), with release/acquire ordering
+ *   completion  complete()/wait_for_completion()
+ *   wait_var    flag + wait_var_event()/wake_up_var(), no wait queue to embed
+ *   hybrid      futex-like: spin on the flag for spin_ns, then sleep with
+ *               wait_var_event(); the signaller only calls wake_up_var()
+ *               when the waiter announced it went to sleep
+ *
+ * Each variant is measured by ping-pong between two kthreads pinned to
+ * cpu_a and cpu_b: A signals B, B signals back, A records the round trip.
+ */
+
+static unsigned int iters = 100000;
+module_param(iters, uint, 0444);
+MODULE_PARM_DESC(iters, "Round trips per variant");
+
+static int cpu_a;
+module_param(cpu_a, int, 0444);
+MODULE_PARM_DESC(cpu_a, "CPU of the pinging kthread");
+
+static int cpu_b = -1;
+module_param(cpu_b, int, 0444);
+MODULE_PARM_DESC(cpu_b, "CPU of the ponging kthread (same as cpu_a is allowed, -1: next online CPU after cpu_a)");
+
+static unsigned int spin_ns = 20000;
+module_param(spin_ns, uint, 0444);
+MODULE_PARM_DESC(spin_ns, "How long the hybrid waiter spins before it sleeps");
+
+enum variant { V_WAITQUEUE, V_COMPLETION, V_WAIT_VAR, V_HYBRID, NR_VARIANTS };
+
+static const char * const variant_names[NR_VARIANTS] = {
+	"waitqueue", "completion", "wait_var", "hybrid",
+};
+
+/* hybrid states */
+enum { CHAN_EMPTY, CHAN_POSTED, CHAN_SLEEPING };
+
+/* one direction of the handshake */
+struct chan {
+	wait_queue_head_t wq;
+	int flag;
+	struct completion done;
+	atomic_t state;
+	unsigned long sleeps;   /* hybrid waits that did not end while spinning */
+};
+
+#define LAT_BUCKETS 32          /* log2(ns) */
+
+struct pingpong {
+	enum variant variant;
+	struct chan ab, ba;
+	bool stop;
+	struct completion finished;
+
+	unsigned int done;
+	u64 rtt_sum;
+	u64 rtt_max;
+	u64 hist[LAT_BUCKETS];
+};
+
+static void chan_init(struct chan *c)
+{
+	init_waitqueue_head(&c->wq);
+	c->flag = 0;
+	init_completion(&c->done);
+	atomic_set(&c->state, CHAN_EMPTY);
+	c->sleeps = 0;
+}
+
+static void chan_signal(enum variant v, struct chan *c)
+{
+	switch (v) {
+	case V_WAITQUEUE:
+		/* wake_up() orders the flag store against the waiter's check */
+		smp_store_release(&c->flag, 1);
+		wake_up(&c->wq);
+		break;
+	case V_COMPLETION:
+		complete(&c->done);
+		break;
+	case V_WAIT_VAR:
+		WRITE_ONCE(c->flag, 1);
+		/* wake_up_var() peeks at the hashed queue without its lock */
+		smp_mb();
+		wake_up_var(&c->flag);
+		break;
+	default:
+		/* xchg is fully ordered: a sleeper announced before is seen */
+		if (atomic_xchg(&c->state, CHAN_POSTED) == CHAN_SLEEPING)
+			wake_up_var(&c->state);
+		break;
+	}
+}
+
+static void chan_wait(enum variant v, struct chan *c)
+{
+	u64 until;
+
+	switch (v) {
+	case V_WAITQUEUE:
+		wait_event(c->wq, smp_load_acquire(&c->flag));
+		WRITE_ONCE(c->flag, 0);
+		break;
+	case V_COMPLETION:
+		wait_for_completion(&c->done);
+		break;
+	case V_WAIT_VAR:
+		wait_var_event(&c->flag, smp_load_acquire(&c->flag));
+		WRITE_ONCE(c->flag, 0);
+		break;
+	default:
+		until = local_clock() + spin_ns;
+		do {
+			if (atomic_read_acquire(&c->state) == CHAN_POSTED)
+				goto consume;
+			cpu_relax();
+		} while (local_clock() < until);
+
+		/* announce the sleep, unless the post arrived meanwhile */
+		if (atomic_cmpxchg(&c->state, CHAN_EMPTY, CHAN_SLEEPING) != CHAN_POSTED) {
+			c->sleeps++;
+			wait_var_event(&c->state, atomic_read_acquire(&c->state) == CHAN_POSTED);
+		}
+consume:
+		atomic_set(&c->state, CHAN_EMPTY);
+		break;
+	}
+}
+
+/* kthread_stop() needs the thread alive until it is called */
+static void wait_for_stop(void)
+{
+	while (!kthread_should_stop()) {
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!kthread_should_stop())
+			schedule();
+		__set_current_state(TASK_RUNNING);
+	}
+}
+
+static int ping_fn(void *arg)
+{
+	struct pingpong *pp = arg;
+	unsigned int i;
+
+	for (i = 0; i < iters && !kthread_should_stop(); i++) {
+		u64 t0 = ktime_get_ns(), rtt;
+
+		chan_signal(pp->variant, &pp->ab);
+		chan_wait(pp->variant, &pp->ba);
+		rtt = ktime_get_ns() - t0;
+
+		pp->done++;
+		pp->rtt_sum += rtt;
+		if (rtt > pp->rtt_max)
+			pp->rtt_max = rtt;
+		pp->hist[min_t(unsigned int, fls64(rtt), LAT_BUCKETS - 1)]++;
+	}
+	complete(&pp->finished);
+	wait_for_stop();
+	return 0;
+}
+
+static int pong_fn(void *arg)
+{
+	struct pingpong *pp = arg;
+
+	for (;;) {
+		chan_wait(pp->variant, &pp->ab);
+		if (READ_ONCE(pp->stop))
+			break;
+		chan_signal(pp->variant, &pp->ba);
+	}
+	wait_for_stop();
+	return 0;
+}
+
+static u64 quantile(const u64 *hist, u64 total, unsigned int pct)
+{
+	u64 want = div_u64(total * pct, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += hist[b];
+		if (seen > want)
+			return b ? 1ULL << b : 1;
+	}
+	return 1ULL << (LAT_BUCKETS - 1);
+}
+
+static struct task_struct *start_pinned(int (*fn)(void *), struct pingpong *pp,
+					int cpu, const char *name)
+{
+	struct task_struct *t = kthread_create(fn, pp, "%s/%d", name, cpu);
+
+	if (!IS_ERR(t)) {
+		kthread_bind(t, cpu);
+		wake_up_process(t);
+	}
+	return t;
+}
+
+static int run_variant(struct pingpong *pp, enum variant v)
+{
+	struct task_struct *ping, *pong;
+
+	memset(pp, 0, sizeof(*pp));
+	pp->variant = v;
+	chan_init(&pp->ab);
+	chan_init(&pp->ba);
+	init_completion(&pp->finished);
+
+	pong = start_pinned(pong_fn, pp, cpu_b, "pong");
+	if (IS_ERR(pong))
+		return PTR_ERR(pong);
+	ping = start_pinned(ping_fn, pp, cpu_a, "ping");
+	if (IS_ERR(ping)) {
+		/* pong is waiting for the first ping */
+		WRITE_ONCE(pp->stop, true);
+		chan_signal(v, &pp->ab);
+		kthread_stop(pong);
+		return PTR_ERR(ping);
+	}
+
+	wait_for_completion(&pp->finished);
+
+	/* ping is done: release pong from its wait */
+	WRITE_ONCE(pp->stop, true);
+	chan_signal(v, &pp->ab);
+	kthread_stop(ping);
+	kthread_stop(pong);
+
+	pr_info("%-10s cpu%d<->cpu%d: %u round trips, avg %llu ns p50<%llu p99<%llu max %llu ns",
+		variant_names[v], cpu_a, cpu_b, pp->done,
+		pp->done ? div_u64(pp->rtt_sum, pp->done) : 0,
+		quantile(pp->hist, pp->done, 50), quantile(pp->hist, pp->done, 99),
+		pp->rtt_max);
+	if (v == V_HYBRID)
+		pr_cont(", slept in %lu+%lu of %u waits\n",
+			pp->ab.sleeps, pp->ba.sleeps, 2 * pp->done);
+	else
+		pr_cont("\n");
+	return 0;
+}
+
+static int __init handshake_bench_init(void)
+{
+	static struct pingpong pp;
+	int v, ret = 0;
+
+	if (!iters || cpu_a < 0 || cpu_a >= nr_cpu_ids || !cpu_online(cpu_a))
+		return -EINVAL;
+
+	/* default: the next online CPU, wrapping around, cpu_a itself on a single core */
+	if (cpu_b == -1) {
+		cpu_b = cpumask_next(cpu_a, cpu_online_mask);
+		if (cpu_b >= nr_cpu_ids)
+			cpu_b = cpumask_first(cpu_online_mask);
+		pr_info("cpu_a=%d cpu_b=%d%s\n", cpu_a, cpu_b,
+			cpu_b == cpu_a ? " (one CPU online, both on it)" : "");
+	}
+	if (cpu_b < 0 || cpu_b >= nr_cpu_ids || !cpu_online(cpu_b))
+		return -EINVAL;
+
+	for (v = 0; v < NR_VARIANTS && !ret; v++)
+		ret = run_variant(&pp, v);
+	return ret;
+}
+
+static void __exit handshake_bench_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(handshake_bench_init);
+module_exit(handshake_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Round trip latency of waitqueue, completion, wait_var_event and spin-then-sleep handshakes");
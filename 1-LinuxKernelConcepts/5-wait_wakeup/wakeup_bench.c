@@ -0,0 +1,303 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/sched/task.h>
+#include <linux/wait.h>
+#include <linux/swait.h>
+#include <linux/atomic.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+
+/*
+ * wait_event_timeout_ex.c waits on a queue nobody wakes. Here n waiter
+ * kthreads sleep on one queue and the module init thread hands out one
+ * token per round:
+ *
+ *   wake_up      prepare_to_wait() + wake_up()       (wakes every waiter)
+ *   wake_up_all  prepare_to_wait() + wake_up_all()
+ *   exclusive    prepare_to_wait_exclusive() + wake_up() (one)
+ *   swait        prepare_to_swait_exclusive() + swake_up_one()
+ *
+ * The first waiter to take the token records the wake-to-run latency
+ * (token posted -> waiter running); every other waiter that woke up finds
+ * no token and goes back to sleep, which is the thundering herd. The round
+ * ends when all waiters are asleep again.
+ *
+ * The waits are open-coded (prepare_to_wait*, schedule, finish_wait*): the
+ * wait_event*() macros check the condition again themselves and put a
+ * loser back to sleep without returning, so its wakeup would not be seen.
+ */
+
+static unsigned int max_waiters = 256;
+module_param(max_waiters, uint, 0444);
+MODULE_PARM_DESC(max_waiters, "Largest waiter count of the sweep 1, 2, 4 ... (1-1024)");
+
+static unsigned int rounds = 1000;
+module_param(rounds, uint, 0444);
+MODULE_PARM_DESC(rounds, "Tokens handed out per mode and waiter count");
+
+enum bench_mode { MODE_WAKE_UP, MODE_WAKE_UP_ALL, MODE_EXCLUSIVE, MODE_SWAIT, NR_MODES };
+
+static const char * const mode_names[NR_MODES] = {
+	"wake_up", "wake_up_all", "exclusive", "swait",
+};
+
+#define LAT_BUCKETS 32          /* log2(ns) */
+
+struct bench {
+	enum bench_mode mode;
+	wait_queue_head_t wq;
+	struct swait_queue_head swq;
+	atomic_t tokens;
+	atomic_t sleeping;      /* waiters in (or about to enter) schedule() */
+	u64 post_ns;            /* when the current token was posted */
+
+	atomic64_t wakeups;     /* returns from schedule(), token or not */
+	spinlock_t lock;        /* latency stats, written by the token winner */
+	u64 won;
+	u64 lat_sum;
+	u64 lat_max;
+	u64 hist[LAT_BUCKETS];
+};
+
+static bool bench_cond(struct bench *b)
+{
+	return atomic_read(&b->tokens) > 0 || kthread_should_stop();
+}
+
+static void bench_record(struct bench *b, u64 lat)
+{
+	spin_lock(&b->lock);
+	b->won++;
+	b->lat_sum += lat;
+	if (lat > b->lat_max)
+		b->lat_max = lat;
+	b->hist[min_t(unsigned int, fls64(lat), LAT_BUCKETS - 1)]++;
+	spin_unlock(&b->lock);
+}
+
+/* one pass through the wait: at most one schedule(), true if it slept */
+static bool bench_wait(struct bench *b)
+{
+	DEFINE_WAIT(wait);
+	DECLARE_SWAITQUEUE(swait);
+	bool slept = false;
+
+	switch (b->mode) {
+	case MODE_WAKE_UP:
+	case MODE_WAKE_UP_ALL:
+		prepare_to_wait(&b->wq, &wait, TASK_INTERRUPTIBLE);
+		break;
+	case MODE_EXCLUSIVE:
+		prepare_to_wait_exclusive(&b->wq, &wait, TASK_INTERRUPTIBLE);
+		break;
+	default:
+		prepare_to_swait_exclusive(&b->swq, &swait, TASK_INTERRUPTIBLE);
+		break;
+	}
+
+	/* checked once queued: a token posted before this is not missed */
+	if (!bench_cond(b)) {
+		atomic_inc(&b->sleeping);
+		schedule();
+		atomic_dec(&b->sleeping);
+		slept = true;
+	}
+
+	if (b->mode == MODE_SWAIT)
+		finish_swait(&b->swq, &swait);
+	else
+		finish_wait(&b->wq, &wait);
+	return slept;
+}
+
+static int waiter_fn(void *arg)
+{
+	struct bench *b = arg;
+
+	while (!kthread_should_stop()) {
+		bool slept = bench_wait(b);
+		u64 now = ktime_get_ns();
+
+		if (kthread_should_stop())
+			break;
+		if (slept)
+			atomic64_inc(&b->wakeups);
+		/* fully ordered: post_ns below is the one of the token we took */
+		if (atomic_dec_if_positive(&b->tokens) >= 0)
+			bench_record(b, now - READ_ONCE(b->post_ns));
+	}
+	return 0;
+}
+
+static void bench_wake(struct bench *b)
+{
+	switch (b->mode) {
+	case MODE_WAKE_UP:
+	case MODE_EXCLUSIVE:
+		wake_up(&b->wq);
+		break;
+	case MODE_WAKE_UP_ALL:
+		wake_up_all(&b->wq);
+		break;
+	default:
+		swake_up_one(&b->swq);
+		break;
+	}
+}
+
+/* any waiter woken but not back in schedule() yet */
+static bool bench_runnable(struct task_struct **tasks, unsigned int n)
+{
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		if (task_is_running(tasks[i]))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Token taken and every waiter back asleep. sleeping counts the waiters
+ * between the increment and schedule() returning; a woken one is still
+ * counted until it runs, its task state (TASK_RUNNING from the wakeup on)
+ * is what tells it apart.
+ */
+static int bench_settle(struct bench *b, struct task_struct **tasks, unsigned int n)
+{
+	u64 deadline = ktime_get_ns() + NSEC_PER_SEC;
+
+	while (atomic_read(&b->tokens) || atomic_read(&b->sleeping) != n ||
+	       bench_runnable(tasks, n)) {
+		if (ktime_get_ns() > deadline)
+			return -ETIMEDOUT;
+		cond_resched();
+		cpu_relax();
+	}
+	return 0;
+}
+
+static u64 quantile(const u64 *hist, u64 total, unsigned int pct)
+{
+	u64 want = div_u64(total * pct, 100), seen = 0;
+	int b;
+
+	for (b = 0; b < LAT_BUCKETS; b++) {
+		seen += hist[b];
+		if (seen > want)
+			return b ? 1ULL << b : 1;
+	}
+	return 1ULL << (LAT_BUCKETS - 1);
+}
+
+static int bench_run(struct bench *b, enum bench_mode mode, unsigned int n,
+		     struct task_struct **tasks)
+{
+	u64 wake_ns = 0, round_ns = 0, cpu_ns = 0, woken = 0, wakeups;
+	unsigned int i, started = 0, done = 0;
+	u32 wakeups_frac;
+	int ret = 0;
+
+	memset(b, 0, sizeof(*b));
+	b->mode = mode;
+	init_waitqueue_head(&b->wq);
+	init_swait_queue_head(&b->swq);
+	spin_lock_init(&b->lock);
+
+	for (i = 0; i < n; i++) {
+		tasks[i] = kthread_create(waiter_fn, b, "wakeup_w/%u", i);
+		if (IS_ERR(tasks[i])) {
+			ret = PTR_ERR(tasks[i]);
+			goto stop;
+		}
+		get_task_struct(tasks[i]);
+		wake_up_process(tasks[i]);
+		started++;
+	}
+
+	ret = bench_settle(b, tasks, n);
+	for (; !ret && done < rounds; done++) {
+		u64 t0, t1;
+
+		t0 = ktime_get_ns();
+		WRITE_ONCE(b->post_ns, t0);
+		atomic_set_release(&b->tokens, 1);
+		bench_wake(b);
+		t1 = ktime_get_ns();
+
+		ret = bench_settle(b, tasks, n);
+		wake_ns += t1 - t0;
+		round_ns += ktime_get_ns() - t0;
+	}
+	if (ret)
+		pr_warn("%s n=%u: waiters did not settle after %u rounds\n",
+			mode_names[mode], n, done);
+
+	/* before kthread_stop(), whose wakeups are not part of the bench */
+	woken = atomic64_read(&b->wakeups);
+
+stop:
+	for (i = 0; i < started; i++) {
+		kthread_stop(tasks[i]);
+		cpu_ns += tasks[i]->se.sum_exec_runtime;
+		put_task_struct(tasks[i]);
+	}
+	if (!done)
+		return ret;
+
+	/* wakeups per round, two decimals */
+	wakeups = div_u64_rem(div_u64(woken * 100, done), 100, &wakeups_frac);
+	pr_info("%-11s n=%4u: wake %6llu ns/call, wake->run avg %6llu p50<%llu p99<%llu max %llu ns, %llu.%02u wakeups/round, round %llu ns, waiters cpu %llu ns/round\n",
+		mode_names[mode], n, div_u64(wake_ns, done),
+		b->won ? div64_u64(b->lat_sum, b->won) : 0,
+		quantile(b->hist, b->won, 50), quantile(b->hist, b->won, 99), b->lat_max,
+		wakeups, wakeups_frac,
+		div_u64(round_ns, done), div_u64(cpu_ns, done));
+	return ret;
+}
+
+static int __init wakeup_bench_init(void)
+{
+	struct task_struct **tasks;
+	struct bench *b;
+	unsigned int n;
+	int mode, ret = 0;
+
+	if (!max_waiters || max_waiters > 1024 || !rounds)
+		return -EINVAL;
+
+	tasks = kcalloc(max_waiters, sizeof(*tasks), GFP_KERNEL);
+	b = kzalloc(sizeof(*b), GFP_KERNEL);
+	if (!tasks || !b) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	pr_info("%u rounds per run, %u CPUs online\n", rounds, num_online_cpus());
+	for (n = 1; n <= max_waiters && !ret; n *= 2) {
+		for (mode = 0; mode < NR_MODES && !ret; mode++)
+			ret = bench_run(b, mode, n, tasks);
+	}
+
+out:
+	kfree(b);
+	kfree(tasks);
+	return ret;
+}
+
+static void __exit wakeup_bench_exit(void)
+{
+	pr_info("exit\n");
+}
+
+module_init(wakeup_bench_init);
+module_exit(wakeup_bench_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Wait queue wake-to-run latency and thundering herd cost");
@@ -0,0 +1,367 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task.h>
+#include <linux/mm.h>
+#include <linux/miscdevice.h>
+#include <linux/fs.h>
+#include <linux/poll.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/log2.h>
+#include <linux/ktime.h>
+#include "task_sampler.h"
+
+/*
+ * A kthread that samples CPU time, RSS and context switches of every
+ * process into per-CPU rings, an in-kernel "top".
+ *
+ * The walk is incremental: every period_ms the kthread visits at most
+ * slice processes, continuing after the one it stopped at last time, so
+ * the cost of one tick is bounded whatever the process count is; a full
+ * pass over N processes takes N / slice ticks. Between ticks it only holds
+ * a reference on the cursor task; if the cursor exited meanwhile the pass
+ * starts over.
+ *
+ * A sample goes to the ring of the CPU the kthread is running on, written
+ * with preemption off: each ring has one producer at a time and needs no
+ * lock. Readers drain the rings with mmap (see task_sampler.h) or read().
+ */
+
+static unsigned int period_ms = 100;
+module_param(period_ms, uint, 0644);
+MODULE_PARM_DESC(period_ms, "Sampling tick");
+
+static unsigned int slice = 1024;
+module_param(slice, uint, 0644);
+MODULE_PARM_DESC(slice, "Processes visited per tick (0 = the whole list every tick)");
+
+static unsigned int ring_pages = 65;
+module_param(ring_pages, uint, 0444);
+MODULE_PARM_DESC(ring_pages, "Pages per CPU ring, header page included");
+
+static int sampler_cpu = -1;
+module_param(sampler_cpu, int, 0444);
+MODULE_PARM_DESC(sampler_cpu, "Pin the sampling kthread to this CPU (-1 = let it float)");
+
+struct ts_ring {
+	struct ts_ring_hdr *hdr;        /* vmalloc_user(), mapped by readers */
+	struct ts_sample *samples;
+	u32 mask;
+};
+
+static struct ts_ring __percpu *rings;
+static unsigned long ring_bytes;
+
+static struct task_struct *sampler;
+static struct task_struct *cursor;     /* where the next tick resumes, referenced */
+static DECLARE_WAIT_QUEUE_HEAD(sampler_wq);
+static DEFINE_MUTEX(read_lock);         /* read() is a single consumer */
+
+/* only touched by the sampler kthread */
+static u64 ticks, passes, samples_taken;
+static u64 tick_ns_max, tick_ns_sum;
+static u64 pass_start_ns;
+static unsigned int pass_tasks;
+
+static void ring_push(const struct ts_sample *s)
+{
+	struct ts_ring *r = get_cpu_ptr(rings);
+	u32 tail = r->hdr->tail;
+
+	/* head is written by user space: only ever used masked */
+	if (tail - smp_load_acquire(&r->hdr->head) > r->mask) {
+		WRITE_ONCE(r->hdr->dropped, r->hdr->dropped + 1);
+	} else {
+		r->samples[tail & r->mask] = *s;
+		smp_store_release(&r->hdr->tail, tail + 1);
+	}
+	put_cpu_ptr(rings);
+}
+
+/* under rcu_read_lock(): threads and signal_struct stay around */
+static void sample_task(struct task_struct *p, u64 now)
+{
+	struct signal_struct *sig = p->signal;
+	struct ts_sample s = {};
+	struct task_struct *t;
+
+	s.ts_ns = now;
+	s.pid = task_tgid_nr(p);
+
+	/* what exited threads left behind, plus the live ones */
+	s.cpu_ns = READ_ONCE(sig->sum_sched_runtime);
+	s.nvcsw = READ_ONCE(sig->nvcsw);
+	s.nivcsw = READ_ONCE(sig->nivcsw);
+	for_each_thread(p, t) {
+		s.cpu_ns += READ_ONCE(t->se.sum_exec_runtime);
+		s.nvcsw += READ_ONCE(t->nvcsw);
+		s.nivcsw += READ_ONCE(t->nivcsw);
+		s.nr_threads++;
+	}
+
+	task_lock(p);
+	strscpy(s.comm, p->comm, sizeof(s.comm));
+	if (p->mm)
+		s.rss_kb = get_mm_rss(p->mm) << (PAGE_SHIFT - 10);
+	task_unlock(p);
+
+	ring_push(&s);
+}
+
+static void sample_slice(void)
+{
+	unsigned int budget = READ_ONCE(slice) ? : UINT_MAX, visited = 0;
+	struct task_struct *p, *old = cursor, *next = NULL;
+	u64 now = ktime_get_ns();
+
+	rcu_read_lock();
+	/*
+	 * pid_alive() is cleared when the task is unhashed, in the same
+	 * critical section that unlinks it: if it is still set, its
+	 * tasks.next is valid for the rest of this read-side section.
+	 */
+	p = old && pid_alive(old) ? old : &init_task;
+	if (p == &init_task)
+		pass_start_ns = now;
+
+	while (visited < budget) {
+		p = next_task(p);
+		if (p == &init_task) {
+			passes++;
+			pr_debug("pass %llu: %u processes in %llu ms\n", passes, pass_tasks,
+				 div_u64(now - pass_start_ns, NSEC_PER_MSEC));
+			pass_tasks = 0;
+			break;
+		}
+		sample_task(p, now);
+		visited++;
+		pass_tasks++;
+	}
+	if (p != &init_task) {
+		next = p;
+		get_task_struct(next);
+	}
+	rcu_read_unlock();
+
+	cursor = next;
+	if (old)
+		put_task_struct(old);
+
+	samples_taken += visited;
+}
+
+static int sampler_fn(void *arg)
+{
+	while (!kthread_should_stop()) {
+		u64 t0 = ktime_get_ns(), dt;
+
+		sample_slice();
+		dt = ktime_get_ns() - t0;
+		ticks++;
+		tick_ns_sum += dt;
+		if (dt > tick_ns_max)
+			tick_ns_max = dt;
+
+		wake_up_interruptible(&sampler_wq);
+		schedule_timeout_interruptible(msecs_to_jiffies(max(READ_ONCE(period_ms), 1U)));
+	}
+	return 0;
+}
+
+static bool rings_have_data(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct ts_ring *r = per_cpu_ptr(rings, cpu);
+
+		if (smp_load_acquire(&r->hdr->tail) != READ_ONCE(r->hdr->head))
+			return true;
+	}
+	return false;
+}
+
+static ssize_t sampler_read(struct file *file, char __user *buf, size_t len, loff_t *ppos)
+{
+	size_t copied = 0;
+	int cpu, ret;
+
+	if (len < sizeof(struct ts_sample))
+		return -EINVAL;
+
+again:
+	if (!(file->f_flags & O_NONBLOCK)) {
+		ret = wait_event_interruptible(sampler_wq, rings_have_data());
+		if (ret)
+			return ret;
+	}
+
+	if (mutex_lock_interruptible(&read_lock))
+		return -EINTR;
+	for_each_possible_cpu(cpu) {
+		struct ts_ring *r = per_cpu_ptr(rings, cpu);
+		u32 tail = smp_load_acquire(&r->hdr->tail);
+		u32 head = READ_ONCE(r->hdr->head);
+
+		/* a mmap reader may have scribbled on head */
+		if (tail - head > r->mask + 1)
+			head = tail - (r->mask + 1);
+
+		while (head != tail && len - copied >= sizeof(struct ts_sample)) {
+			if (copy_to_user(buf + copied, &r->samples[head & r->mask],
+					 sizeof(struct ts_sample))) {
+				smp_store_release(&r->hdr->head, head);
+				mutex_unlock(&read_lock);
+				return copied ? copied : -EFAULT;
+			}
+			copied += sizeof(struct ts_sample);
+			head++;
+		}
+		smp_store_release(&r->hdr->head, head);
+	}
+	mutex_unlock(&read_lock);
+
+	/* another reader got there first */
+	if (!copied && !(file->f_flags & O_NONBLOCK))
+		goto again;
+	return copied ? copied : -EAGAIN;
+}
+
+static __poll_t sampler_poll(struct file *file, poll_table *wait)
+{
+	poll_wait(file, &sampler_wq, wait);
+	return rings_have_data() ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
+/* offset cpu * ring_bytes maps the ring of that CPU */
+static int sampler_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long cpu = vma->vm_pgoff / ring_pages;
+
+	if (vma->vm_pgoff % ring_pages || vma->vm_end - vma->vm_start != ring_bytes)
+		return -EINVAL;
+	if (cpu >= nr_cpu_ids || !cpu_possible(cpu))
+		return -ENXIO;
+
+	return remap_vmalloc_range(vma, per_cpu_ptr(rings, cpu)->hdr, 0);
+}
+
+static const struct file_operations sampler_fops = {
+	.owner = THIS_MODULE,
+	.read  = sampler_read,
+	.poll  = sampler_poll,
+	.mmap  = sampler_mmap,
+	.llseek = noop_llseek,
+};
+
+static struct miscdevice sampler_misc = {
+	.minor = MISC_DYNAMIC_MINOR,
+	.name  = "task_sampler",
+	.fops  = &sampler_fops,
+	.mode  = 0644,
+};
+
+static void rings_free(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		vfree(per_cpu_ptr(rings, cpu)->hdr);
+	free_percpu(rings);
+}
+
+static int rings_alloc(void)
+{
+	u32 entries = rounddown_pow_of_two((ring_pages - 1) * PAGE_SIZE / sizeof(struct ts_sample));
+	int cpu;
+
+	rings = alloc_percpu(struct ts_ring);
+	if (!rings)
+		return -ENOMEM;
+
+	ring_bytes = (unsigned long)ring_pages << PAGE_SHIFT;
+	for_each_possible_cpu(cpu) {
+		struct ts_ring *r = per_cpu_ptr(rings, cpu);
+
+		r->hdr = vmalloc_user(ring_bytes);
+		if (!r->hdr) {
+			rings_free();
+			return -ENOMEM;
+		}
+		r->hdr->entries = entries;
+		r->samples = (void *)r->hdr + PAGE_SIZE;
+		r->mask = entries - 1;
+	}
+	return 0;
+}
+
+static int __init task_sampler_init(void)
+{
+	int ret;
+
+	BUILD_BUG_ON(sizeof(struct ts_ring_hdr) > PAGE_SIZE);
+
+	if (ring_pages < 2 || !period_ms ||
+	    (sampler_cpu >= 0 && (sampler_cpu >= nr_cpu_ids || !cpu_online(sampler_cpu))))
+		return -EINVAL;
+
+	ret = rings_alloc();
+	if (ret)
+		return ret;
+
+	ret = misc_register(&sampler_misc);
+	if (ret)
+		goto err_rings;
+
+	sampler = kthread_create(sampler_fn, NULL, "task_sampler");
+	if (IS_ERR(sampler)) {
+		ret = PTR_ERR(sampler);
+		goto err_misc;
+	}
+	if (sampler_cpu >= 0)
+		kthread_bind(sampler, sampler_cpu);
+	wake_up_process(sampler);
+
+	pr_info("%u entries per CPU ring, %u processes every %u ms\n",
+		per_cpu_ptr(rings, 0)->mask + 1, slice, period_ms);
+	return 0;
+
+err_misc:
+	misc_deregister(&sampler_misc);
+err_rings:
+	rings_free();
+	return ret;
+}
+
+static void __exit task_sampler_exit(void)
+{
+	u64 dropped = 0;
+	int cpu;
+
+	kthread_stop(sampler);
+	if (cursor)
+		put_task_struct(cursor);
+	misc_deregister(&sampler_misc);
+
+	for_each_possible_cpu(cpu)
+		dropped += per_cpu_ptr(rings, cpu)->hdr->dropped;
+	pr_info("%llu ticks, %llu passes, %llu samples (%llu dropped), tick avg %llu us max %llu us\n",
+		ticks, passes, samples_taken, dropped,
+		ticks ? div_u64(div64_u64(tick_ns_sum, ticks), NSEC_PER_USEC) : 0,
+		div_u64(tick_ns_max, NSEC_PER_USEC));
+	rings_free();
+}
+
+module_init(task_sampler_init);
+module_exit(task_sampler_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Incremental per-process sampling into per-CPU rings, read or mmapped");
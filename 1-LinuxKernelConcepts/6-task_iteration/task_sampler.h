@@ -0,0 +1,48 @@
+#ifndef TASK_SAMPLER_H
+#define TASK_SAMPLER_H
+
+/*
+ * Interface of task_sampler, shared by the module and user/task_top.c.
+ *
+ * There is one ring per possible CPU. A ring is ring_pages pages (module
+ * parameter): the first page holds struct ts_ring_hdr, the rest the
+ * samples. Ring <cpu> is mapped with
+ *
+ *   mmap(NULL, ring_pages * page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+ *        fd, cpu * ring_pages * page_size);
+ *
+ * The kernel publishes tail (store-release) after writing a sample, the
+ * reader consumes up to tail (load-acquire) and publishes head. Both are
+ * free running u32 counters, index = counter & (entries - 1). When the ring
+ * is full new samples are dropped and counted in dropped.
+ *
+ * read() on /dev/task_sampler does the same draining in the kernel and
+ * returns whole struct ts_sample records; don't mix it with mmap readers.
+ */
+#include <linux/types.h>
+
+#define TS_DEVICE "/dev/task_sampler"
+
+struct ts_ring_hdr {
+    __u32 tail;          /* written by the kernel */
+    __u32 entries;       /* power of two */
+    __u32 dropped;
+    __u32 pad0;
+    __u8  pad1[48];
+    __u32 head;          /* written by the reader, own cache line */
+    __u8  pad2[60];
+};
+
+/* one process at one point in time */
+struct ts_sample {
+    __u64 ts_ns;         /* CLOCK_MONOTONIC */
+    __u64 cpu_ns;        /* all threads, exited ones included */
+    __u64 nvcsw;         /* voluntary context switches, all threads */
+    __u64 nivcsw;        /* involuntary ones */
+    __u64 rss_kb;
+    __s32 pid;           /* tgid */
+    __u32 nr_threads;
+    char  comm[16];
+};
+
+#endif
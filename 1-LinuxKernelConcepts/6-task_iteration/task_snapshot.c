@@ -0,0 +1,316 @@
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task.h>
+#include <linux/mm.h>
+#include <linux/cgroup.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/uaccess.h>
+#include <linux/string.h>
+#include <linux/ktime.h>
+
+/*
+ * kthreads_ex.c pr_info()s every process. This copies the processes that
+ * match a filter into a preallocated array in one RCU read-side section,
+ * and serves the copy through /proc/task_snapshot with seq_file, so the
+ * output can be read at any pace without holding anything over the task
+ * list:
+ *
+ *   cat /proc/task_snapshot             current snapshot
+ *   echo scan > /proc/task_snapshot     take a new one
+ *   echo "bench 100" > /proc/...        100 scans, timing to the kernel log
+ *
+ * Filters are module parameters, writable at runtime; they apply to the
+ * next scan.
+ */
+
+static char comm_prefix[TASK_COMM_LEN];
+module_param_string(comm_prefix, comm_prefix, sizeof(comm_prefix), 0644);
+MODULE_PARM_DESC(comm_prefix, "Keep processes whose comm starts with this (empty = all)");
+
+static char states[16];
+module_param_string(states, states, sizeof(states), 0644);
+MODULE_PARM_DESC(states, "Keep processes in these states, ps letters e.g. \"RD\" (empty = all)");
+
+static unsigned long long cgroup_id;
+module_param(cgroup_id, ullong, 0644);
+MODULE_PARM_DESC(cgroup_id, "Keep processes in this cgroup v2 (inode number of its directory) or below it (0 = all)");
+
+static unsigned long min_rss_kb;
+module_param(min_rss_kb, ulong, 0644);
+MODULE_PARM_DESC(min_rss_kb, "Keep processes with at least this resident set, in KiB");
+
+static unsigned int max_tasks = 131072;
+module_param(max_tasks, uint, 0444);
+MODULE_PARM_DESC(max_tasks, "Snapshot capacity, allocated at load time");
+
+struct task_snap {
+	pid_t pid;
+	pid_t ppid;
+	char state;
+	char comm[TASK_COMM_LEN];
+	int nr_threads;
+	unsigned long rss_kb;
+	u64 cgroup_id;
+};
+
+struct snap_filter {
+	char comm[TASK_COMM_LEN];
+	size_t comm_len;
+	char states[16];
+	u64 cgroup_id;
+	unsigned long min_rss_kb;
+};
+
+/* everything below is protected by snap_lock */
+static DEFINE_MUTEX(snap_lock);
+static struct task_snap *snap;
+static unsigned int snap_nr;
+static unsigned int snap_seen;
+static unsigned int snap_dropped;       /* matched, but the array was full */
+static unsigned long snap_gen;
+static u64 snap_scan_ns;
+
+static struct proc_dir_entry *snap_proc;
+
+static u64 task_cgroup_id(struct task_struct *p)
+{
+#ifdef CONFIG_CGROUPS
+	return cgroup_id(task_dfl_cgroup(p));
+#else
+	return 0;
+#endif
+}
+
+/* the cgroup itself or one of its descendants; RCU keeps the css_set alive */
+static bool task_in_cgroup(struct task_struct *p, u64 id)
+{
+#ifdef CONFIG_CGROUPS
+	struct cgroup *cgrp;
+
+	for (cgrp = task_dfl_cgroup(p); cgrp; cgrp = cgroup_parent(cgrp)) {
+		if (cgroup_id(cgrp) == id)
+			return true;
+	}
+#endif
+	return false;
+}
+
+static void filter_load(struct snap_filter *f)
+{
+	strscpy(f->comm, comm_prefix, sizeof(f->comm));
+	f->comm_len = strlen(f->comm);
+	strscpy(f->states, states, sizeof(f->states));
+	f->cgroup_id = cgroup_id;
+	f->min_rss_kb = min_rss_kb;
+}
+
+/* caller holds snap_lock */
+static void snapshot_scan(void)
+{
+	struct snap_filter f;
+	struct task_struct *p;
+	unsigned int nr = 0, seen = 0, dropped = 0;
+	u64 t0;
+
+	filter_load(&f);
+
+	t0 = ktime_get_ns();
+	rcu_read_lock();
+	for_each_process(p) {
+		struct task_snap *s;
+		char comm[TASK_COMM_LEN];
+		unsigned long rss = 0;
+		char state;
+
+		seen++;
+
+		/* cheap checks first, no lock needed */
+		state = task_state_to_char(p);
+		if (f.states[0] && !strchr(f.states, state))
+			continue;
+		if (f.cgroup_id && !task_in_cgroup(p, f.cgroup_id))
+			continue;
+
+		/* task_lock: comm changes and mm goes away under it */
+		task_lock(p);
+		strscpy(comm, p->comm, sizeof(comm));
+		if (p->mm)
+			rss = get_mm_rss(p->mm) << (PAGE_SHIFT - 10);
+		task_unlock(p);
+
+		if (f.comm_len && strncmp(comm, f.comm, f.comm_len))
+			continue;
+		if (rss < f.min_rss_kb)
+			continue;
+		if (nr == max_tasks) {
+			dropped++;
+			continue;
+		}
+
+		s = &snap[nr++];
+		s->pid = task_pid_nr(p);
+		s->ppid = task_tgid_nr(rcu_dereference(p->real_parent));
+		s->state = state;
+		memcpy(s->comm, comm, sizeof(s->comm));
+		s->nr_threads = get_nr_threads(p);
+		s->rss_kb = rss;
+		s->cgroup_id = task_cgroup_id(p);
+	}
+	rcu_read_unlock();
+
+	snap_scan_ns = ktime_get_ns() - t0;
+	snap_nr = nr;
+	snap_seen = seen;
+	snap_dropped = dropped;
+	snap_gen++;
+}
+
+/*
+ * m->private holds the generation the reader started on: if a scan
+ * replaced the snapshot between two read() calls the output ends there
+ * instead of mixing two snapshots.
+ */
+static void *snap_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&snap_lock);
+
+	if (*pos == 0) {
+		m->private = (void *)snap_gen;
+		return SEQ_START_TOKEN;
+	}
+	if ((unsigned long)m->private != snap_gen)
+		return NULL;
+	return *pos <= snap_nr ? &snap[*pos - 1] : NULL;
+}
+
+static void *snap_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	return *pos <= snap_nr ? &snap[*pos - 1] : NULL;
+}
+
+static void snap_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&snap_lock);
+}
+
+static int snap_seq_show(struct seq_file *m, void *v)
+{
+	const struct task_snap *s = v;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_printf(m, "# generation %lu: %u of %u processes matched, %u dropped, scan %llu us (%llu ns/process)\n",
+			   snap_gen, snap_nr, snap_seen, snap_dropped,
+			   div_u64(snap_scan_ns, NSEC_PER_USEC),
+			   snap_seen ? div_u64(snap_scan_ns, snap_seen) : 0);
+		seq_printf(m, "%8s %8s S %10s %7s %8s COMM\n",
+			   "PID", "PPID", "RSS_KB", "THREADS", "CGROUP");
+		return 0;
+	}
+
+	seq_printf(m, "%8d %8d %c %10lu %7d %8llu %s\n", s->pid, s->ppid, s->state,
+		   s->rss_kb, s->nr_threads, s->cgroup_id, s->comm);
+	return 0;
+}
+
+static const struct seq_operations snap_seq_ops = {
+	.start = snap_seq_start,
+	.next  = snap_seq_next,
+	.stop  = snap_seq_stop,
+	.show  = snap_seq_show,
+};
+
+static int snap_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &snap_seq_ops);
+}
+
+/* "scan" or "bench <n>" */
+static ssize_t snap_write(struct file *file, const char __user *ubuf,
+			  size_t len, loff_t *ppos)
+{
+	u64 min_ns = U64_MAX, max_ns = 0, sum_ns = 0;
+	unsigned int i, n = 1;
+	char buf[32];
+
+	if (len >= sizeof(buf))
+		return -EINVAL;
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+	buf[len] = '\0';
+
+	if (!sysfs_streq(buf, "scan") &&
+	    (sscanf(buf, "bench %u", &n) != 1 || !n || n > 10000))
+		return -EINVAL;
+
+	if (mutex_lock_interruptible(&snap_lock))
+		return -EINTR;
+	for (i = 0; i < n; i++) {
+		snapshot_scan();
+		min_ns = min(min_ns, snap_scan_ns);
+		max_ns = max(max_ns, snap_scan_ns);
+		sum_ns += snap_scan_ns;
+		cond_resched();
+	}
+	if (n > 1)
+		pr_info("%u scans of %u processes (%u matched): min %llu avg %llu max %llu us, %llu ns/process\n",
+			n, snap_seen, snap_nr, div_u64(min_ns, NSEC_PER_USEC),
+			div_u64(div_u64(sum_ns, n), NSEC_PER_USEC), div_u64(max_ns, NSEC_PER_USEC),
+			snap_seen ? div_u64(div_u64(sum_ns, n), snap_seen) : 0);
+	mutex_unlock(&snap_lock);
+
+	return len;
+}
+
+static const struct proc_ops snap_proc_ops = {
+	.proc_open    = snap_open,
+	.proc_read    = seq_read,
+	.proc_lseek   = seq_lseek,
+	.proc_release = seq_release,
+	.proc_write   = snap_write,
+};
+
+static int __init task_snapshot_init(void)
+{
+	if (!max_tasks)
+		return -EINVAL;
+
+	snap = vmalloc(array_size(max_tasks, sizeof(*snap)));
+	if (!snap)
+		return -ENOMEM;
+
+	mutex_lock(&snap_lock);
+	snapshot_scan();
+	mutex_unlock(&snap_lock);
+
+	snap_proc = proc_create("task_snapshot", 0644, NULL, &snap_proc_ops);
+	if (!snap_proc) {
+		vfree(snap);
+		return -ENOMEM;
+	}
+
+	pr_info("%u of %u processes in the first snapshot, capacity %u\n",
+		snap_nr, snap_seen, max_tasks);
+	return 0;
+}
+
+static void __exit task_snapshot_exit(void)
+{
+	proc_remove(snap_proc);
+	vfree(snap);
+	pr_info("exit\n");
+}
+
+module_init(task_snapshot_init);
+module_exit(task_snapshot_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_AUTHOR("Ahmed");
+MODULE_DESCRIPTION("Filtered RCU snapshot of the process list behind a seq_file");
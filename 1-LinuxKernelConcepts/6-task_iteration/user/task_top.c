@@ -0,0 +1,264 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "../task_sampler.h"
+
+/*
+ * "top" on top of task_sampler: drains the per-CPU sample rings (with
+ * read() or by mmapping them) and every interval prints the processes that
+ * used the most CPU between their last two samples.
+ */
+
+#define MAX_RINGS   256
+#define TABLE_BITS  18          /* 256k processes */
+#define TABLE_SIZE  (1u << TABLE_BITS)
+
+struct proc_ent {
+    int pid;
+    unsigned int nr_threads;
+    char comm[16];
+    uint64_t rss_kb;
+    uint64_t prev_ts, prev_cpu, prev_csw;
+    uint64_t last_ts, last_cpu, last_csw;
+};
+
+struct mapped_ring {
+    struct ts_ring_hdr *hdr;
+    struct ts_sample *samples;
+};
+
+static struct proc_ent *table;
+static unsigned long tracked;
+
+void print_usage(const char *prog_name) {
+    printf("Usage: %s [-m] [-i <seconds>] [-n <lines>]\n", prog_name);
+    printf("  -m            mmap the rings instead of read()\n");
+    printf("  -i <seconds>  refresh interval (default 2)\n");
+    printf("  -n <lines>    processes shown (default 15)\n");
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* open addressing on the pid, never deletes: pids are reused anyway */
+static struct proc_ent *lookup(int pid) {
+    unsigned int i = ((unsigned int)pid * 2654435761u) >> (32 - TABLE_BITS);
+
+    for (unsigned int n = 0; n < TABLE_SIZE; n++, i = (i + 1) & (TABLE_SIZE - 1)) {
+        if (table[i].pid == pid)
+            return &table[i];
+        if (table[i].pid == 0) {
+            table[i].pid = pid;
+            tracked++;
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static void account(const struct ts_sample *s) {
+    struct proc_ent *e = lookup(s->pid);
+
+    if (!e || s->pid == 0)
+        return;
+    /* a new process behind a reused pid starts over */
+    if (strncmp(e->comm, s->comm, sizeof(e->comm)) != 0 || s->cpu_ns < e->last_cpu) {
+        memcpy(e->comm, s->comm, sizeof(e->comm));
+        e->last_ts = 0;
+    }
+    e->prev_ts = e->last_ts;
+    e->prev_cpu = e->last_cpu;
+    e->prev_csw = e->last_csw;
+    e->last_ts = s->ts_ns;
+    e->last_cpu = s->cpu_ns;
+    e->last_csw = s->nvcsw + s->nivcsw;
+    e->rss_kb = s->rss_kb;
+    e->nr_threads = s->nr_threads;
+}
+
+static long drain_read(int fd, struct ts_sample *buf, size_t nbuf) {
+    long total = 0;
+
+    for (;;) {
+        ssize_t got = read(fd, buf, nbuf * sizeof(*buf));
+        if (got < 0) {
+            if (errno == EAGAIN)
+                return total;
+            perror("read");
+            return -1;
+        }
+        for (size_t i = 0; i < got / sizeof(*buf); i++)
+            account(&buf[i]);
+        total += got / sizeof(*buf);
+    }
+}
+
+static long drain_mmap(struct mapped_ring *rings, int nrings) {
+    long total = 0;
+
+    for (int c = 0; c < nrings; c++) {
+        struct ts_ring_hdr *h = rings[c].hdr;
+        uint32_t mask = h->entries - 1;
+        uint32_t head = h->head;
+        uint32_t tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++, total++)
+            account(&rings[c].samples[head & mask]);
+        __atomic_store_n(&h->head, head, __ATOMIC_RELEASE);
+    }
+    return total;
+}
+
+static int map_rings(int fd, struct mapped_ring *rings) {
+    long page = sysconf(_SC_PAGESIZE);
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    unsigned int ring_pages = 0;
+    FILE *f = fopen("/sys/module/task_sampler/parameters/ring_pages", "r");
+    int n = 0;
+
+    if (!f || fscanf(f, "%u", &ring_pages) != 1) {
+        fprintf(stderr, "cannot read ring_pages, is task_sampler loaded?\n");
+        if (f)
+            fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    for (long cpu = 0; cpu < ncpus && n < MAX_RINGS; cpu++) {
+        size_t size = (size_t)ring_pages * page;
+        void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, cpu * size);
+        if (mem == MAP_FAILED) {
+            if (errno == ENXIO)
+                break;
+            perror("mmap");
+            return -1;
+        }
+        rings[n].hdr = mem;
+        rings[n].samples = (struct ts_sample *)((char *)mem + page);
+        n++;
+    }
+    return n;
+}
+
+static int by_cpu_rate(const void *a, const void *b) {
+    const struct proc_ent *x = *(struct proc_ent * const *)a;
+    const struct proc_ent *y = *(struct proc_ent * const *)b;
+    double rx = (double)(x->last_cpu - x->prev_cpu) / (x->last_ts - x->prev_ts);
+    double ry = (double)(y->last_cpu - y->prev_cpu) / (y->last_ts - y->prev_ts);
+
+    return rx < ry ? 1 : rx > ry ? -1 : 0;
+}
+
+static void show(struct proc_ent **sorted, int lines, long samples, double secs,
+                 struct mapped_ring *rings, int nrings) {
+    unsigned long n = 0, dropped = 0;
+
+    for (unsigned int i = 0; i < TABLE_SIZE; i++) {
+        struct proc_ent *e = &table[i];
+        if (e->pid && e->prev_ts && e->last_ts > e->prev_ts)
+            sorted[n++] = e;
+    }
+    qsort(sorted, n, sizeof(*sorted), by_cpu_rate);
+
+    for (int c = 0; c < nrings; c++)
+        dropped += rings[c].hdr->dropped;
+
+    printf("\n%.0f samples/s, %lu pids seen, %lu with two samples", samples / secs, tracked, n);
+    if (nrings)
+        printf(", %lu dropped", dropped);
+    printf("\n%8s %-16s %6s %9s %10s %7s\n", "PID", "COMM", "%CPU", "CSW/s", "RSS_KB", "THREADS");
+    for (unsigned long i = 0; i < n && i < (unsigned long)lines; i++) {
+        struct proc_ent *e = sorted[i];
+        double dt = (e->last_ts - e->prev_ts) / 1e9;
+
+        printf("%8d %-16.16s %6.1f %9.0f %10llu %7u\n", e->pid, e->comm,
+               100.0 * (e->last_cpu - e->prev_cpu) / 1e9 / dt,
+               (e->last_csw - e->prev_csw) / dt,
+               (unsigned long long)e->rss_kb, e->nr_threads);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct mapped_ring rings[MAX_RINGS];
+    int use_mmap = 0, nrings = 0;
+    double interval = 2;
+    int lines = 15;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "mi:n:")) != -1) {
+        switch (opt) {
+            case 'm':
+                use_mmap = 1;
+                break;
+            case 'i':
+                interval = atof(optarg);
+                break;
+            case 'n':
+                lines = atoi(optarg);
+                break;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+    if (interval <= 0 || lines <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    table = calloc(TABLE_SIZE, sizeof(*table));
+    struct proc_ent **sorted = calloc(TABLE_SIZE, sizeof(*sorted));
+    struct ts_sample *buf = calloc(4096, sizeof(*buf));
+    if (!table || !sorted || !buf) {
+        perror("calloc");
+        return 1;
+    }
+
+    int fd = open(TS_DEVICE, O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        perror(TS_DEVICE);
+        return 1;
+    }
+    if (use_mmap) {
+        nrings = map_rings(fd, rings);
+        if (nrings <= 0)
+            return 1;
+    }
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    double t0 = now_sec(), next = t0 + interval;
+    long samples = 0;
+
+    for (;;) {
+        int timeout = (int)((next - now_sec()) * 1000);
+        if (timeout > 0 && poll(&pfd, 1, timeout) < 0 && errno != EINTR) {
+            perror("poll");
+            return 1;
+        }
+
+        long got = use_mmap ? drain_mmap(rings, nrings) : drain_read(fd, buf, 4096);
+        if (got < 0)
+            return 1;
+        samples += got;
+
+        double now = now_sec();
+        if (now >= next) {
+            show(sorted, lines, samples, now - t0, rings, nrings);
+            fflush(stdout);
+            samples = 0;
+            t0 = now;
+            next = now + interval;
+        }
+    }
+}
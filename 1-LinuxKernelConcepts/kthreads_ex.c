@@ -9,11 +9,12 @@ static int __init my_module_init(void) {
 
     pr_info("my_module_init\n");
 
-    rcu_read_unlock();
+    /* the task list is RCU protected: tasks can't be freed under us */
+    rcu_read_lock();
     for_each_process(tasks) {
         pr_info("Process: %s [PID: %d]\n", tasks->comm, tasks->pid);
     }
-    rcu_read_lock();
+    rcu_read_unlock();
 
     return 0;
 }
@@ -19,7 +19,7 @@ static int __init wait_event_timeout_example_init(void)
     // pr_info("Kernel time in nanoseconds: %lld\n", ns);
 
     // Simulate a condition change after a small delay using udelay
-    udelay(10); // 1 millisecond delay
+    udelay(10); // 10 microsecond delay
     condition = 1;
 
     if (wait_event_timeout(my_wait_queue, condition != 0, timeout)) {